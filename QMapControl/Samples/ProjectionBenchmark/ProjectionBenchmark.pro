@@ -0,0 +1,15 @@
+include(../../QMapControl.pri)
+DEPENDPATH += src
+MOC_DIR = tmp
+OBJECTS_DIR = obj
+DESTDIR = ../bin
+TARGET = ProjectionBenchmark
+
+QT+=network
+QT+=gui
+greaterThan(QT_MAJOR_VERSION, 4): cache()
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+# Input
+SOURCES += src/projectionbenchmark.cpp
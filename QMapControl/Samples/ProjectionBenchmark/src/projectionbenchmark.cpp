@@ -0,0 +1,124 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QVector>
+#include <osmmapadapter.h>
+#include <wmsmapadapter.h>
+#include <random>
+
+using namespace qmapcontrol;
+
+static const int kDefaultCoordinates = 1000000;
+static const int kRounds = 10;
+
+static void measure(const QString& name, const MapAdapter* adapter, const QVector<QPointF>& coordinates, QTextStream& out)
+{
+    const int count = coordinates.size();
+    QVector<QPoint> single(count);
+    QVector<QPoint> batch(count);
+    QVector<QPointF> singleBack(count);
+    QVector<QPointF> batchBack(count);
+
+    QElapsedTimer time;
+    time.start();
+    for (int round=0; round<kRounds; ++round)
+    {
+        for (int i=0; i<count; ++i)
+        {
+            single[i] = adapter->coordinateToDisplay(coordinates.at(i));
+        }
+    }
+    const qint64 singleMs = time.elapsed();
+
+    time.restart();
+    for (int round=0; round<kRounds; ++round)
+    {
+        adapter->coordinatesToDisplay(coordinates.constData(), batch.data(), count);
+    }
+    const qint64 batchMs = time.elapsed();
+
+    time.restart();
+    for (int round=0; round<kRounds; ++round)
+    {
+        for (int i=0; i<count; ++i)
+        {
+            singleBack[i] = adapter->displayToCoordinate(single.at(i));
+        }
+    }
+    const qint64 singleBackMs = time.elapsed();
+
+    time.restart();
+    for (int round=0; round<kRounds; ++round)
+    {
+        adapter->displayToCoordinates(single.constData(), batchBack.data(), count);
+    }
+    const qint64 batchBackMs = time.elapsed();
+
+    out << name << "\n";
+    out << "  coordinateToDisplay:  " << singleMs << " ms, coordinatesToDisplay: " << batchMs << " ms"
+        << (single == batch ? "" : " (results differ)") << "\n";
+    out << "  displayToCoordinate:  " << singleBackMs << " ms, displayToCoordinates: " << batchBackMs << " ms"
+        << (singleBack == batchBack ? "" : " (results differ)") << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    const int count = args.isEmpty() ? kDefaultCoordinates : args.first().toInt();
+    if (count <= 0)
+    {
+        QTextStream(stderr) << "Usage: ProjectionBenchmark [coordinates]\n";
+        return 2;
+    }
+
+    // within the latitudes the Mercator projection covers, the same on each run
+    QVector<QPointF> coordinates(count);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> longitude(-180.0, 180.0);
+    std::uniform_real_distribution<double> latitude(-85.0, 85.0);
+    for (int i=0; i<count; ++i)
+    {
+        const double x = longitude(random);
+        coordinates[i] = QPointF(x, latitude(random));
+    }
+
+    QTextStream out(stdout);
+    out << count << " coordinates, " << kRounds << " rounds\n";
+
+    OSMMapAdapter osm;
+    measure("OSMMapAdapter", &osm, coordinates, out);
+
+    WMSMapAdapter wms("www2.demis.nl", "/wms/wms.asp?wms=WorldMap&LAYERS=Countries&FORMAT=image/png&VERSION=1.1.1&SERVICE=WMS&REQUEST=GetMap&STYLES=&SRS=EPSG:4326&TRANSPARENT=FALSE", 256);
+    measure("WMSMapAdapter", &wms, coordinates, out);
+
+    return 0;
+}
@@ -2,5 +2,7 @@ SUBDIRS += Mapviewer \
 	LinesAndPoints \
 	GPS \
 	Multidemo \
-	Citymap
+	Citymap \
+	Seeder \
+	ProjectionBenchmark
 TEMPLATE = subdirs 
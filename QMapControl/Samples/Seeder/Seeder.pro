@@ -0,0 +1,16 @@
+include(../../QMapControl.pri)
+DEPENDPATH += src
+MOC_DIR = tmp
+OBJECTS_DIR = obj
+DESTDIR = ../bin
+TARGET = Seeder
+
+QT+=network
+QT+=gui
+greaterThan(QT_MAJOR_VERSION, 4): cache()
+CONFIG += console
+CONFIG -= app_bundle
+
+# Input
+HEADERS += src/seeder.h
+SOURCES += src/main.cpp src/seeder.cpp
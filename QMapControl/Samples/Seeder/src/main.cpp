@@ -0,0 +1,92 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+#include "seeder.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    QTextStream err(stderr);
+    if (args.size() < 7)
+    {
+        err << "Usage: Seeder url west south east north minzoom maxzoom [--cache dir] [--pack file] [--parallel n] [--user-agent agent]\n"
+            << "  url is the tile server with %1 for the zoom, %2 for x and %3 for y, e.g. https://tiles.example.org/%1/%2/%3.png\n";
+        return 2;
+    }
+
+    // the url is split into the host and the path of the tiles
+    const QString url = args.at(0);
+    const int scheme = url.indexOf("://");
+    const int path = url.indexOf('/', scheme < 0 ? 0 : scheme + 3);
+    if (path < 0 || !url.contains("%1") || !url.contains("%2") || !url.contains("%3"))
+    {
+        err << "The url needs a path with %1, %2 and %3 for the zoom, x and y of the tiles\n";
+        return 2;
+    }
+
+    Seeder seeder(url.left(path), url.mid(path));
+    QString cacheDir;
+    QString packFile;
+    for (int i=7; i+1<args.size(); i+=2)
+    {
+        if (args.at(i) == "--cache")
+        {
+            cacheDir = args.at(i+1);
+            seeder.seeder()->setCacheDir(cacheDir);
+        }
+        else if (args.at(i) == "--pack")
+        {
+            packFile = args.at(i+1);
+            seeder.seeder()->setTilePack(packFile);
+        }
+        else if (args.at(i) == "--parallel")
+        {
+            seeder.seeder()->setMaxConcurrentRequests(args.at(i+1).toInt());
+        }
+        else if (args.at(i) == "--user-agent")
+        {
+            seeder.seeder()->setUserAgent(args.at(i+1).toUtf8());
+        }
+    }
+
+    if (cacheDir.isEmpty() && packFile.isEmpty())
+    {
+        err << "Give a cache directory (--cache) and/or a tile pack (--pack) to save the tiles to\n";
+        return 2;
+    }
+
+    QRectF area(QPointF(args.at(1).toDouble(), args.at(2).toDouble()),
+                QPointF(args.at(3).toDouble(), args.at(4).toDouble()));
+    seeder.start(area, args.at(5).toInt(), args.at(6).toInt());
+
+    return app.exec();
+}
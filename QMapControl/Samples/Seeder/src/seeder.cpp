@@ -0,0 +1,82 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "seeder.h"
+
+#include <QCoreApplication>
+
+/*!
+ * \example seeder.cpp
+ * This command line tool loads all tiles of an area from a tile server in advance, so it can be used without network.
+ * A TileSeeder enumerates the tiles of the area with its own TileMapAdapter and loads them.
+ * The progress and the throughput are written to the console.
+ *
+ * You can find this example here: QMapControl/Samples/Seeder
+ */
+Seeder::Seeder(const QString& host, const QString& serverPath, QObject *parent)
+    : QObject(parent), out(stdout)
+{
+    // the seeder zooms its mapadapter, so it gets one which is not displayed
+    mapadapter = new TileMapAdapter(host, serverPath, 256, 0, 19);
+    tileSeeder = new TileSeeder(this);
+
+    connect(tileSeeder, SIGNAL(progress(int, int)),
+            this, SLOT(progress(int, int)));
+    connect(tileSeeder, SIGNAL(finished(int)),
+            this, SLOT(finished(int)));
+}
+
+Seeder::~Seeder()
+{
+    delete mapadapter;
+}
+
+TileSeeder* Seeder::seeder()
+{
+    return tileSeeder;
+}
+
+void Seeder::start(const QRectF& area, int fromZoom, int toZoom)
+{
+    int tiles = tileSeeder->start(mapadapter, area, fromZoom, toZoom);
+    out << "Loading " << tiles << " tiles\n";
+    out.flush();
+}
+
+void Seeder::progress(int finished, int total)
+{
+    out << "\r" << finished << "/" << total
+        << " tiles, " << qRound(tileSeeder->tilesPerSecond()) << " tiles/s, "
+        << qRound(tileSeeder->bytesPerSecond() / 1024) << " KB/s   ";
+    out.flush();
+}
+
+void Seeder::finished(int failed)
+{
+    out << "\n" << (tileSeeder->finishedTiles() - failed) << " tiles loaded, "
+        << failed << " failed, " << (tileSeeder->loadedBytes() / 1024) << " KB\n";
+    out.flush();
+    QCoreApplication::exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,56 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef SEEDER_H
+#define SEEDER_H
+
+#include <QObject>
+#include <QTextStream>
+#include <tileseeder.h>
+#include <tilemapadapter.h>
+
+using namespace qmapcontrol;
+class Seeder : public QObject
+{
+    Q_OBJECT
+
+public:
+    Seeder(const QString& host, const QString& serverPath, QObject *parent = 0);
+    ~Seeder();
+
+    TileSeeder* seeder();
+    void start(const QRectF& area, int fromZoom, int toZoom);
+
+private:
+    TileSeeder* tileSeeder;
+    MapAdapter* mapadapter;
+    QTextStream out;
+
+private slots:
+    void progress(int finished, int total);
+    void finished(int failed);
+};
+
+#endif
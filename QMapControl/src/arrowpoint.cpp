@@ -43,8 +43,10 @@ namespace qmapcontrol
    
     void ArrowPoint::setHeading(qreal heading)
     {
+        emit(updateRequest(this));
         h = heading;
         drawArrow();
+        emit(updateRequest(this));
     }
 
     qreal ArrowPoint::getHeading() const
@@ -54,8 +56,10 @@ namespace qmapcontrol
     
     void ArrowPoint::setPen(QPen* pen)
     {
+        emit(updateRequest(this));
         mypen = pen;
         drawArrow();
+        emit(updateRequest(this));
     }
 
     void ArrowPoint::drawArrow()
@@ -58,13 +58,19 @@ namespace qmapcontrol
     }
 
     QPoint bingApiMapadapter::coordinateToDisplay(const QPointF& coordinate) const
+    {
+        const QPointF point = bingApiMapadapter::coordinateToDisplayF(coordinate);
+        return QPoint(int(point.x()), int(point.y()));
+    }
+
+    QPointF bingApiMapadapter::coordinateToDisplayF(const QPointF& coordinate) const
     {
         qreal x = (coordinate.x() + 180.) * (mNumberOfTiles * mTileSize) / 360.;		// coord to pixel!
         qreal y = (1. - log(tan(coordinate.y() * M_PI / 180.) + 1. / cos(coordinate.y() * M_PI / 180.)) / M_PI) / 2. * (mNumberOfTiles*mTileSize);
         x += mTileSize / 2;
         y += mTileSize / 2;
 
-        return QPoint(int(x), int(y));
+        return QPointF(x, y);
     }
 
     QPointF bingApiMapadapter::displayToCoordinate(const QPoint& point) const
@@ -76,6 +82,22 @@ namespace qmapcontrol
         return QPointF(lon, lat);
     }
 
+    void bingApiMapadapter::coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const
+    {
+        // the projection of TileMapAdapter doesn't apply
+        MapAdapter::coordinatesToDisplay(coordinates, points, count);
+    }
+
+    void bingApiMapadapter::coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const
+    {
+        MapAdapter::coordinatesToDisplayF(coordinates, points, count);
+    }
+
+    void bingApiMapadapter::displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const
+    {
+        MapAdapter::displayToCoordinates(points, coordinates, count);
+    }
+
     qreal bingApiMapadapter::getMercatorLatitude(qreal YCoord) const
     {
         if (YCoord > M_PI) return 9999.;
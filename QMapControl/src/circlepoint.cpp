@@ -51,8 +51,10 @@ namespace qmapcontrol
 
     void CirclePoint::setPen(QPen* pen)
     {
+        emit(updateRequest(this));
         mypen = pen;
         drawCircle();
+        emit(updateRequest(this));
     }
 
     void CirclePoint::drawCircle()
@@ -24,6 +24,96 @@
 */
 
 #include "curve.h"
+
+// lines with fewer points are drawn without simplifying them
+static const int kMinSimplifiedPoints = 64;
+// the simplified line differs from the drawn points by less than this, in pixels
+static const qreal kSimplifyTolerance = 1.0;
+
+namespace
+{
+    enum OutCode
+    {
+        kInside = 0,
+        kLeft = 1,
+        kRight = 2,
+        kTop = 4,
+        kBottom = 8
+    };
+
+    int outCode(const QRectF& rect, qreal x, qreal y)
+    {
+        int code = kInside;
+        if (x < rect.left())
+            code |= kLeft;
+        else if (x > rect.right())
+            code |= kRight;
+        if (y < rect.top())
+            code |= kTop;
+        else if (y > rect.bottom())
+            code |= kBottom;
+        return code;
+    }
+
+    // Douglas-Peucker simplification of the points from first on, returns the indices of the points which are kept
+    QVector<int> douglasPeucker(const QVector<QPointF>& points, int first, qreal tolerance)
+    {
+        const int count = points.size();
+        QVector<bool> keep(count-first, false);
+        keep[0] = true;
+        keep[count-1-first] = true;
+
+        // a stack instead of recursion, long tracks would exceed the call stack
+        QVector<QPair<int, int> > ranges;
+        ranges.append(qMakePair(first, count-1));
+        while (!ranges.isEmpty())
+        {
+            const QPair<int, int> range = ranges.last();
+            ranges.remove(ranges.size()-1);
+
+            const QPointF a = points.at(range.first);
+            const qreal dx = points.at(range.second).x() - a.x();
+            const qreal dy = points.at(range.second).y() - a.y();
+            const qreal length = dx*dx + dy*dy;
+
+            qreal farthest = 0;
+            int index = -1;
+            for (int i=range.first+1; i<range.second; ++i)
+            {
+                // distance to the segment, not to the line, so tracks which turn back are kept
+                const qreal px = points.at(i).x() - a.x();
+                const qreal py = points.at(i).y() - a.y();
+                const qreal t = length > 0 ? qBound(qreal(0), (px*dx + py*dy) / length, qreal(1)) : 0;
+                const qreal ex = px - t*dx;
+                const qreal ey = py - t*dy;
+                const qreal distance = ex*ex + ey*ey;
+                if (distance > farthest)
+                {
+                    farthest = distance;
+                    index = i;
+                }
+            }
+
+            if (index >= 0 && farthest > tolerance*tolerance)
+            {
+                keep[index-first] = true;
+                ranges.append(qMakePair(range.first, index));
+                ranges.append(qMakePair(index, range.second));
+            }
+        }
+
+        QVector<int> kept;
+        for (int i=first; i<count; ++i)
+        {
+            if (keep.at(i-first))
+            {
+                kept.append(i);
+            }
+        }
+        return kept;
+    }
+}
+
 namespace qmapcontrol
 {
     Curve::Curve(QString name)
@@ -35,6 +125,107 @@ namespace qmapcontrol
     Curve::~Curve()
     {
     }
+
+    void Curve::drawClipped(QPainter* painter, const QRectF& clip, const QVector<QPointF>& line)
+    {
+        // consecutive visible segments are drawn as one polyline, so the joins are kept
+        QPolygonF p = QPolygonF();
+        for (int i=1; i<line.size(); i++)
+        {
+            QPointF from = line.at(i-1);
+            QPointF to = line.at(i);
+            if (clipSegment(clip, &from, &to))
+            {
+                if (p.isEmpty() || p.last() != from)
+                {
+                    if (p.size() > 1)
+                    {
+                        painter->drawPolyline(p);
+                    }
+                    p.clear();
+                    p.append(from);
+                }
+                p.append(to);
+            }
+        }
+        if (p.size() > 1)
+        {
+            painter->drawPolyline(p);
+        }
+    }
+
+    // Cohen-Sutherland clipping
+    bool Curve::clipSegment(const QRectF& rect, QPointF* a, QPointF* b)
+    {
+        qreal x1 = a->x();
+        qreal y1 = a->y();
+        qreal x2 = b->x();
+        qreal y2 = b->y();
+        int code1 = outCode(rect, x1, y1);
+        int code2 = outCode(rect, x2, y2);
+        if ((code1 | code2) == kInside)
+        {
+            return true;
+        }
+
+        while ((code1 | code2) != kInside)
+        {
+            if ((code1 & code2) != kInside)
+            {
+                return false;
+            }
+
+            const int code = code1 != kInside ? code1 : code2;
+            qreal x;
+            qreal y;
+            if (code & kTop)
+            {
+                x = x1 + (x2-x1) * (rect.top()-y1) / (y2-y1);
+                y = rect.top();
+            }
+            else if (code & kBottom)
+            {
+                x = x1 + (x2-x1) * (rect.bottom()-y1) / (y2-y1);
+                y = rect.bottom();
+            }
+            else if (code & kLeft)
+            {
+                x = rect.left();
+                y = y1 + (y2-y1) * (rect.left()-x1) / (x2-x1);
+            }
+            else
+            {
+                x = rect.right();
+                y = y1 + (y2-y1) * (rect.right()-x1) / (x2-x1);
+            }
+
+            if (code == code1)
+            {
+                x1 = x;
+                y1 = y;
+                code1 = outCode(rect, x1, y1);
+            }
+            else
+            {
+                x2 = x;
+                y2 = y;
+                code2 = outCode(rect, x2, y2);
+            }
+        }
+
+        *a = QPointF(x1, y1);
+        *b = QPointF(x2, y2);
+        return true;
+    }
+
+    QVector<int> Curve::simplify(const QVector<QPointF>& line, int from)
+    {
+        if (line.size() < kMinSimplifiedPoints || from >= line.size())
+        {
+            return QVector<int>();
+        }
+        return douglasPeucker(line, from, kSimplifyTolerance);
+    }
 }
 // Geometry Curve::Clone(){}
 
@@ -29,12 +29,13 @@
 #include "qmapcontrol_global.h"
 #include "geometry.h"
 #include "point.h"
+#include <QVector>
 
 namespace qmapcontrol
 {
     //! A Curve Geometry, implemented to fullfil OGC Spec
     /*!
-     * The Curve class is used by LineString as parent class.
+     * The Curve class is used by LineString and Polyline as parent class.
      * This class could not be used directly.
      *
      * From the OGC Candidate Implementation Specification:
@@ -61,6 +62,32 @@ namespace qmapcontrol
     protected:
         Curve(QString name = QString());
         virtual void draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &screensize, const QPoint offset) = 0;
+
+        //! draws the parts of a line within the clip rect
+        /*!
+         * The segments are cut at the border of the clip rect with sub-pixel precision,
+         * so the line doesn't wobble when it is antialiased.
+         * @param painter the painter with the pen of the line
+         * @param clip the area which is drawn, in display coordinates
+         * @param line the points of the line, in display coordinates
+         */
+        static void drawClipped(QPainter* painter, const QRectF& clip, const QVector<QPointF>& line);
+
+        //! cuts a segment at the border of a rect
+        /*!
+         * @return false if the segment is completely outside of the rect
+         */
+        static bool clipSegment(const QRectF& rect, QPointF* a, QPointF* b);
+
+        //! returns the indices of the points which are drawn at a zoom level
+        /*!
+         * Leaves out the points which would not change the line by more than a pixel.
+         * Short lines are not simplified, an empty vector is returned for them.
+         * @param line the points of the line, in display coordinates of the zoom level
+         * @param from the index of the first point to simplify, the points before it are left out
+         * @return the indices of the kept points, or an empty vector if all are kept
+         */
+        static QVector<int> simplify(const QVector<QPointF>& line, int from = 0);
     };
 }
 #endif
@@ -76,11 +76,17 @@ namespace qmapcontrol
     }
 
     QPoint EmptyMapAdapter::coordinateToDisplay(const QPointF& coordinate) const
+    {
+        const QPointF point = EmptyMapAdapter::coordinateToDisplayF(coordinate);
+        return QPoint(int(point.x()), int(point.y()));
+    }
+
+    QPointF EmptyMapAdapter::coordinateToDisplayF(const QPointF& coordinate) const
     {
         qreal x = (coordinate.x()+180) * (mNumberOfTiles*mTileSize)/360.; // coord to pixel!
         qreal y = (1-(log(tan(PI/4+deg_rad(coordinate.y())/2)) /PI)) /2  * (mNumberOfTiles*mTileSize);
 
-        return QPoint(int(x), int(y));
+        return QPointF(x, y);
     }
 
     QPointF EmptyMapAdapter::displayToCoordinate(const QPoint& point) const
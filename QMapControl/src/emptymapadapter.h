@@ -54,6 +54,7 @@ namespace qmapcontrol
         virtual ~EmptyMapAdapter();
 
         virtual QPoint coordinateToDisplay(const QPointF&) const;
+        virtual QPointF coordinateToDisplayF(const QPointF&) const;
         virtual QPointF displayToCoordinate(const QPoint&) const;
 
         qreal PI;
@@ -49,15 +49,20 @@ namespace qmapcontrol
         if (!visible)
             return;
 
-            const QPointF c = QPointF(X, Y);
-            QPoint topleft = mapadapter->coordinateToDisplay(c);
+            // the image is scaled with sub-pixel precision, so its edges don't jump while zooming
+            const QPointF topleft = mapadapter->coordinateToDisplayF(QPointF(X, Y));
+            const QPointF lowerright = mapadapter->coordinateToDisplayF(QPointF(x_lowerright, y_lowerright));
 
-            const QPointF c2 = QPointF(x_lowerright, y_lowerright);
-            QPoint lowerright = mapadapter->coordinateToDisplay(c2);
+        painter->drawPixmap(QRectF(topleft, lowerright), mypixmap, QRectF(mypixmap.rect()));
 
-        painter->drawPixmap(topleft.x(), topleft.y(), lowerright.x()-topleft.x(), lowerright.y()-topleft.y(), mypixmap);
 
+    }
 
+    QRect FixedImageOverlay::displayBoundingBox(const MapAdapter* mapadapter)
+    {
+        const QPoint topleft = mapadapter->coordinateToDisplay(QPointF(X, Y));
+        const QPoint lowerright = mapadapter->coordinateToDisplay(QPointF(x_lowerright, y_lowerright));
+        return QRect(topleft, lowerright).normalized().adjusted(-1, -1, 1, 1);
     }
 
     FixedImageOverlay::~FixedImageOverlay()
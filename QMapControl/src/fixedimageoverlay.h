@@ -71,6 +71,7 @@ namespace qmapcontrol
         FixedImageOverlay(qreal x_upperleft, qreal y_upperleft, qreal x_lowerright, qreal y_lowerright, QPixmap pixmap, QString name = QString());
 
         virtual void draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &viewport, const QPoint offset);
+        virtual QRect displayBoundingBox(const MapAdapter* mapadapter);
         virtual ~FixedImageOverlay();
 
     private:
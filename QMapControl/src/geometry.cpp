@@ -24,10 +24,11 @@
 */
 
 #include "geometry.h"
+#include <qmath.h>
 namespace qmapcontrol
 {
     Geometry::Geometry(QString name)
-            : GeometryType("Geometry"), myparentGeometry(0), mypen(0), visible(true), myname(name)
+            : GeometryType("Geometry"), myparentGeometry(0), dynamic(false), mypen(0), visible(true), myname(name)
     {
     }
 
@@ -68,7 +69,36 @@ namespace qmapcontrol
     void Geometry::setVisible(bool visible)
     {
         this->visible = visible;
-        emit(updateRequest(boundingBox()));
+        emit(updateRequest(this));
+    }
+
+    void Geometry::setDynamic(bool dynamic)
+    {
+        // the geometry moves between the cache and the live drawing of its layer
+        emit(updateRequest(this));
+        this->dynamic = dynamic;
+        emit(updateRequest(this));
+    }
+
+    bool Geometry::isDynamic() const
+    {
+        return dynamic;
+    }
+
+    QRect Geometry::displayBoundingBox(const MapAdapter* mapadapter)
+    {
+        const QRectF box = boundingBox();
+        const QRect rect = QRect(mapadapter->coordinateToDisplay(box.topLeft()),
+                                 mapadapter->coordinateToDisplay(box.bottomRight())).normalized();
+
+        const int margin = penMargin();
+        return rect.adjusted(-margin, -margin, margin, margin);
+    }
+
+    int Geometry::penMargin() const
+    {
+        // half of the pen reaches beyond the outline, and Touches() accepts clicks at least 2 pixels away
+        return qMax(2, mypen != 0 ? qCeil(mypen->widthF()/2) : 0) + 1;
     }
 
     void Geometry::setName(QString name)
@@ -78,7 +108,10 @@ namespace qmapcontrol
 
     void Geometry::setPen(QPen* pen)
     {
+        // a wider pen covers more of the map
+        emit(updateRequest(this));
         mypen = pen;
+        emit(updateRequest(this));
     }
     QPen* Geometry::pen() const
     {
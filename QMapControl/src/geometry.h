@@ -48,6 +48,7 @@ namespace qmapcontrol
     class QMAPCONTROL_EXPORT Geometry : public QObject
     {
         friend class LineString;
+        friend class Polyline;
         Q_OBJECT
     public:
         explicit Geometry(QString name = QString());
@@ -89,6 +90,17 @@ namespace qmapcontrol
          */
         bool isVisible() const;
 
+        //! marks the Geometry as one which changes often
+        /*!
+         * A GeometryLayer with a static geometry cache draws dynamic geometries on each paint,
+         * all other geometries are drawn once into the cache. Use this for moving objects like vehicles.
+         * @param dynamic true if the Geometry changes often, default is false
+         */
+        void setDynamic(bool dynamic);
+
+        //! returns true if the Geometry is marked as changing often
+        bool isDynamic() const;
+
         //! sets the name of the geometry
         /*!
          * @param name the new name of the geometry
@@ -108,6 +120,15 @@ namespace qmapcontrol
          * @return the BoundingBox
          */
         virtual QRectF boundingBox()=0;
+
+        //! returns the area the Geometry covers when it is drawn
+        /*!
+         * The area includes the pen, pixmaps and the area which accepts clicks. It is used to redraw
+         * only the changed part of the map and to find the geometries within an area.
+         * @param mapadapter the MapAdapter the Geometry is drawn with
+         * @return the bounding box in display coordinates of the MapAdapter
+         */
+        virtual QRect displayBoundingBox(const MapAdapter* mapadapter);
         virtual bool Touches(Point* geom, const MapAdapter* mapadapter)=0;
         virtual void draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &viewport, const QPoint offset)=0;
         virtual bool hasPoints() const;
@@ -121,14 +142,23 @@ namespace qmapcontrol
 
         Geometry* myparentGeometry;
         QList<Geometry*> 	touchedPoints;
+        bool dynamic;
 
     protected:
         QPen* mypen;
         bool visible;
         QString myname;
         void setParentGeometry(Geometry* geom);
+        //! returns how far the pen and the area accepting clicks reach beyond the outline, in pixels
+        int penMargin() const;
 
     signals:
+        //! A Geometry emits this signal before and after it changes how it is drawn
+        /*!
+         * The layer redraws the displayBoundingBox() of the Geometry at both times,
+         * so the old and the new area are updated.
+         * @param geom the Geometry
+         */
         void updateRequest(Geometry* geom);
         void updateRequest(QRectF rect);
         //! This signal is emitted when a Geometry is clicked
@@ -0,0 +1,245 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "geometryindex.h"
+
+// a node is split when it holds more geometries, unless it is already very small
+static const int kMaxNodeGeometries = 16;
+static const qint64 kMinNodeSize = 64;
+// covers the display coordinates of all zoom levels
+static const qint64 kRootSize = Q_INT64_C(1) << 31;
+
+namespace qmapcontrol
+{
+    GeometryIndex::Node::Node(qint64 x, qint64 y, qint64 size)
+        :   x(x),
+            y(y),
+            size(size),
+            count(0)
+    {
+        children[0] = children[1] = children[2] = children[3] = 0;
+    }
+
+    GeometryIndex::Node::~Node()
+    {
+        for (int i=0; i<4; ++i)
+        {
+            delete children[i];
+        }
+    }
+
+    GeometryIndex::GeometryIndex()
+        :   root(new Node(-kRootSize/2, -kRootSize/2, kRootSize))
+    {
+    }
+
+    GeometryIndex::~GeometryIndex()
+    {
+        delete root;
+    }
+
+    void GeometryIndex::insert(Geometry* geometry, const QRect& rect)
+    {
+        if (rects.contains(geometry))
+        {
+            if (rects.value(geometry) == rect)
+            {
+                return;
+            }
+            remove(geometry);
+        }
+
+        rects.insert(geometry, rect);
+        insert(root, geometry, rect);
+    }
+
+    void GeometryIndex::remove(Geometry* geometry)
+    {
+        QHash<Geometry*, QRect>::iterator it = rects.find(geometry);
+        if (it == rects.end())
+        {
+            return;
+        }
+        const QRect rect = it.value();
+        rects.erase(it);
+
+        // the position of a geometry only depends on its area, so it is found on the way down
+        Node* node = root;
+        QList<Node*> path;
+        while (true)
+        {
+            path.append(node);
+            const int child = childFor(node, rect);
+            if (node->children[0] == 0 || child < 0)
+            {
+                break;
+            }
+            node = node->children[child];
+        }
+        node->geometries.removeOne(geometry);
+
+        foreach (Node* n, path)
+        {
+            --n->count;
+            if (n->count == 0 && n->children[0] != 0)
+            {
+                // drops empty subtrees, the nodes below are part of the path
+                for (int i=0; i<4; ++i)
+                {
+                    delete n->children[i];
+                    n->children[i] = 0;
+                }
+                break;
+            }
+        }
+    }
+
+    bool GeometryIndex::contains(Geometry* geometry) const
+    {
+        return rects.contains(geometry);
+    }
+
+    void GeometryIndex::clear()
+    {
+        delete root;
+        root = new Node(-kRootSize/2, -kRootSize/2, kRootSize);
+        rects.clear();
+    }
+
+    QList<Geometry*> GeometryIndex::intersecting(const QRect& rect) const
+    {
+        QList<Geometry*> result;
+        if (rect.isValid())
+        {
+            collect(root, rect, &result);
+        }
+        return result;
+    }
+
+    int GeometryIndex::count() const
+    {
+        return rects.size();
+    }
+
+    int GeometryIndex::childFor(const Node* node, const QRect& rect) const
+    {
+        const qint64 middleX = node->x + node->size/2;
+        const qint64 middleY = node->y + node->size/2;
+
+        int child = 0;
+        if (rect.left() >= middleX)
+        {
+            child += 1;
+        }
+        else if (rect.right() >= middleX)
+        {
+            return -1;
+        }
+        if (rect.top() >= middleY)
+        {
+            child += 2;
+        }
+        else if (rect.bottom() >= middleY)
+        {
+            return -1;
+        }
+        return child;
+    }
+
+    void GeometryIndex::insert(Node* node, Geometry* geometry, const QRect& rect)
+    {
+        ++node->count;
+        if (node->children[0] == 0)
+        {
+            node->geometries.append(geometry);
+            if (node->geometries.size() > kMaxNodeGeometries && node->size > kMinNodeSize)
+            {
+                split(node);
+            }
+            return;
+        }
+
+        const int child = childFor(node, rect);
+        if (child < 0)
+        {
+            node->geometries.append(geometry);
+        }
+        else
+        {
+            insert(node->children[child], geometry, rect);
+        }
+    }
+
+    void GeometryIndex::split(Node* node)
+    {
+        const qint64 half = node->size/2;
+        for (int i=0; i<4; ++i)
+        {
+            node->children[i] = new Node(node->x + (i & 1)*half, node->y + (i >> 1)*half, half);
+        }
+
+        const QList<Geometry*> geometries = node->geometries;
+        node->geometries.clear();
+        foreach (Geometry* geometry, geometries)
+        {
+            const QRect& rect = rects[geometry];
+            const int child = childFor(node, rect);
+            if (child < 0)
+            {
+                node->geometries.append(geometry);
+            }
+            else
+            {
+                insert(node->children[child], geometry, rect);
+            }
+        }
+    }
+
+    void GeometryIndex::collect(const Node* node, const QRect& rect, QList<Geometry*>* result) const
+    {
+        foreach (Geometry* geometry, node->geometries)
+        {
+            if (rects.value(geometry).intersects(rect))
+            {
+                result->append(geometry);
+            }
+        }
+
+        if (node->children[0] == 0)
+        {
+            return;
+        }
+        for (int i=0; i<4; ++i)
+        {
+            const Node* child = node->children[i];
+            if (child->count > 0 &&
+                rect.right() >= child->x && rect.left() < child->x + child->size &&
+                rect.bottom() >= child->y && rect.top() < child->y + child->size)
+            {
+                collect(child, rect, result);
+            }
+        }
+    }
+}
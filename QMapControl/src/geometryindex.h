@@ -0,0 +1,103 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef GEOMETRYINDEX_H
+#define GEOMETRYINDEX_H
+
+#include "qmapcontrol_global.h"
+#include <QHash>
+#include <QList>
+#include <QRect>
+
+namespace qmapcontrol
+{
+    class Geometry;
+
+    //! Finds the geometries of a Layer within an area
+    /*!
+     * The index is a quadtree over the display coordinates of one zoom level.
+     * Each Geometry is kept in the smallest node which contains its whole area,
+     * so lookups only visit the nodes which intersect the requested area.
+     *
+     * The index does not observe the geometries, it has to be updated when their area changes.
+     */
+    class QMAPCONTROL_EXPORT GeometryIndex
+    {
+    public:
+        GeometryIndex();
+        ~GeometryIndex();
+
+        //! adds a Geometry or moves it to a new area
+        /*!
+         * @param geometry the Geometry
+         * @param rect its area in display coordinates
+         */
+        void insert(Geometry* geometry, const QRect& rect);
+
+        //! removes a Geometry
+        void remove(Geometry* geometry);
+
+        //! returns true if the Geometry is in the index
+        bool contains(Geometry* geometry) const;
+
+        //! removes all geometries
+        void clear();
+
+        //! returns the geometries whose area intersects the given one, in no particular order
+        /*!
+         * @param rect the area in display coordinates
+         * @return the found geometries
+         */
+        QList<Geometry*> intersecting(const QRect& rect) const;
+
+        //! returns the number of geometries in the index
+        int count() const;
+
+    private:
+        Q_DISABLE_COPY (GeometryIndex)
+
+        struct Node
+        {
+            Node(qint64 x, qint64 y, qint64 size);
+            ~Node();
+
+            qint64 x;
+            qint64 y;
+            qint64 size;
+            int count; // geometries in this node and below
+            QList<Geometry*> geometries; // the ones which don't fit into a single child
+            Node* children[4]; // 0 for a leaf
+        };
+
+        int childFor(const Node* node, const QRect& rect) const;
+        void insert(Node* node, Geometry* geometry, const QRect& rect);
+        void split(Node* node);
+        void collect(const Node* node, const QRect& rect, QList<Geometry*>* result) const;
+
+        Node* root;
+        QHash<Geometry*, QRect> rects;
+    };
+}
+#endif
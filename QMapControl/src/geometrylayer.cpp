@@ -35,4 +35,16 @@ namespace qmapcontrol
     GeometryLayer::~GeometryLayer()
     {
     }
+
+    void GeometryLayer::setStaticGeometryCache(bool enabled)
+    {
+        cacheStatic = enabled;
+        invalidateStaticGeometries();
+        emit(updateRequest());
+    }
+
+    bool GeometryLayer::hasStaticGeometryCache() const
+    {
+        return cacheStatic;
+    }
 }
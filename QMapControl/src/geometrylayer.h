@@ -61,6 +61,21 @@ namespace qmapcontrol
          */
         GeometryLayer(QString layername, MapAdapter* mapadapter, bool takeevents=true);
         virtual ~GeometryLayer();
+
+        //! draws the static geometries once into a cached image
+        /*!
+         * The cached image covers the offscreen area of the map. It is drawn again on zoom, when the
+         * map is scrolled past it and, for their area only, when static geometries change.
+         * Geometries which are marked with Geometry::setDynamic() are drawn on each paint on top of it.
+         * This is useful for many fixed geometries, like routes and places, below a few moving ones.
+         * Changes which a custom geometry does not announce with Geometry::updateRequest(Geometry*)
+         * are drawn after MapControl::updateRequestNew().
+         * @param enabled true to cache the static geometries, default is false
+         */
+        void setStaticGeometryCache(bool enabled);
+
+        //! returns true if the static geometries are drawn into a cached image
+        bool hasStaticGeometryCache() const;
     };
 }
 #endif
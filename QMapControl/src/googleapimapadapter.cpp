@@ -78,13 +78,19 @@ namespace qmapcontrol
     }
 
     QPoint googleApiMapadapter::coordinateToDisplay(const QPointF& coordinate) const
+    {
+        const QPointF point = googleApiMapadapter::coordinateToDisplayF(coordinate);
+        return QPoint(int(point.x()), int(point.y()));
+    }
+
+    QPointF googleApiMapadapter::coordinateToDisplayF(const QPointF& coordinate) const
     {
         qreal x = (coordinate.x() + 180.) * (mNumberOfTiles * mTileSize) / 360.;		// coord to pixel!
         qreal y = (1. - log(tan(coordinate.y() * PI / 180.) + 1. / cos(coordinate.y() * PI / 180.)) / PI) / 2. * (mNumberOfTiles*mTileSize);
         x += mTileSize / 2;
         y += mTileSize / 2;
 
-        return QPoint(int(x), int(y));
+        return QPointF(x, y);
     }
 
     QPointF googleApiMapadapter::displayToCoordinate(const QPoint& point) const
@@ -96,6 +102,22 @@ namespace qmapcontrol
         return QPointF(lon, lat);
     }
 
+    void googleApiMapadapter::coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const
+    {
+        // the projection of TileMapAdapter doesn't apply
+        MapAdapter::coordinatesToDisplay(coordinates, points, count);
+    }
+
+    void googleApiMapadapter::coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const
+    {
+        MapAdapter::coordinatesToDisplayF(coordinates, points, count);
+    }
+
+    void googleApiMapadapter::displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const
+    {
+        MapAdapter::displayToCoordinates(points, coordinates, count);
+    }
+
     qreal googleApiMapadapter::getMercatorLatitude(qreal YCoord) const
     {
         if (YCoord > PI) return 9999.;
@@ -63,7 +63,11 @@ namespace qmapcontrol
         virtual ~googleApiMapadapter();
 
         virtual QPoint coordinateToDisplay(const QPointF&) const;
+        virtual QPointF coordinateToDisplayF(const QPointF&) const;
         virtual QPointF displayToCoordinate(const QPoint&) const;
+        virtual void coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const;
+        virtual void coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const;
+        virtual void displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const;
 
         QString	getHost() const;
         void setKey(QString apiKey);
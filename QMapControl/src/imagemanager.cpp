@@ -25,12 +25,22 @@
 
 #include "imagemanager.h"
 #include "mapnetwork.h"
+#include "mapadapter.h"
 #include <QCryptographicHash>
 #include <QPainter>
 #include <QDateTime>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
 
-static const int kDefaultTimeoutDelaySecs = 30;
-static const int kDefaultPixmapCacheSizeKB = 20000;
+// a failed tile is requested again after this delay, which doubles with each failure
+static const int kFailedTileDelayMs = 5000;
+static const int kMaxFailedTileDelayMs = 1800000;
+static const int kMaxFailedTiles = 4096;
+// zoom levels above a missing tile which are searched for a placeholder
+static const int kMaxPlaceholderLevels = 4;
+// tiles received within this interval are painted together
+static const int kReceivedTilesIntervalMs = 16;
 
 namespace qmapcontrol
 {
@@ -49,11 +59,6 @@ namespace qmapcontrol
         QBrush brush( Qt::lightGray, Qt::Dense5Pattern );
         paint.fillRect(loadingPixmap.rect(), brush );
         paint.end();
-
-        if (QPixmapCache::cacheLimit() <= kDefaultPixmapCacheSizeKB)
-        {
-            QPixmapCache::setCacheLimit(kDefaultPixmapCacheSizeKB);
-        }
     }
 
     ImageManager::~ImageManager()
@@ -62,75 +67,172 @@ namespace qmapcontrol
         net = 0;
     }
 
-    QPixmap ImageManager::getImage(const QString& host, const QString& url)
+    QPixmap ImageManager::getImage(const TileKey& tile)
     {
-        //qDebug() << "ImageManager::getImage";
-        QPixmap pm;
+        return requestImage(tile, false);
+    }
 
-        if ( net->imageIsLoading(url) )
-        {
-            //currently loading an image
-            return loadingPixmap;
-        }
-        else if ( QPixmapCache::find(url, &pm) )
+    bool ImageManager::drawImage(QPainter* painter, const QPoint& topLeft, const TileKey& tile)
+    {
+        const QPixmap pm = requestImage(tile, false);
+        const bool missing = pm.cacheKey() == loadingPixmap.cacheKey() || pm.cacheKey() == emptyPixmap.cacheKey();
+        if ( !missing || !drawPlaceholder(painter, topLeft, tile) )
         {
-           //image found in cache, use this version
-            return pm;
+            painter->drawPixmap(topLeft, pm);
         }
-        //is image cached (memory)
-        else if ( QPixmapCache::find(url, &pm) &&
-                  !pm.isNull() )
+        return !missing;
+    }
+
+    bool ImageManager::drawPlaceholder(QPainter* painter, const QPoint& topLeft, const TileKey& tile) const
+    {
+        const MapAdapter* adapter = tile.adapter;
+        const int tilesize = adapter->tilesize();
+        const int direction = adapter->minZoom() > adapter->maxZoom() ? -1 : 1;
+        const int lowestZoom = qMin(adapter->minZoom(), adapter->maxZoom());
+        const int highestZoom = qMax(adapter->minZoom(), adapter->maxZoom());
+
+        const bool smooth = painter->testRenderHint(QPainter::SmoothPixmapTransform);
+        painter->setRenderHint(QPainter::SmoothPixmapTransform);
+
+        // the four tiles of the next zoom level, they are cached after zooming out
+        QPixmap children[4];
+        int found = 0;
+        const int childZoom = tile.z + direction;
+        if (childZoom >= lowestZoom && childZoom <= highestZoom)
         {
-            //we had a valid copy cached in memory (not disk) so return this
-            return pm;
+            for (int i=0; i<4; ++i)
+            {
+                if (tiles.peek(TileKey(adapter, tile.x*2 + i%2, tile.y*2 + i/2, childZoom), &children[i]) &&
+                    !children[i].isNull())
+                {
+                    ++found;
+                }
+            }
         }
-        else if ( failedFetches.contains(url) &&
-                  failedFetches[url].secsTo(QDateTime::currentDateTime()) < kDefaultTimeoutDelaySecs )
+
+        bool drawn = false;
+        if (found < 4)
         {
-            //prevents spamming public servers when requests fail to return an image or server returns error code (busy/ivalid useragent etc)
-            qDebug() << "Ignored: " << url << " - last request failed less than 30 seconds ago";
+            // a part of the nearest cached tile above, it is cached after zooming in
+            for (int level=1; level<=kMaxPlaceholderLevels && !drawn; ++level)
+            {
+                const int zoom = tile.z - level*direction;
+                if (zoom < lowestZoom || zoom > highestZoom)
+                {
+                    break;
+                }
+
+                QPixmap pm;
+                if (tiles.peek(TileKey(adapter, tile.x >> level, tile.y >> level, zoom), &pm) && !pm.isNull())
+                {
+                    const int mask = (1 << level) - 1;
+                    const qreal part = qreal(pm.width()) / (1 << level);
+                    painter->drawPixmap(QRectF(topLeft, QSizeF(tilesize, tilesize)), pm,
+                                        QRectF((tile.x & mask) * part, (tile.y & mask) * part, part, part));
+                    drawn = true;
+                }
+            }
         }
-        else
+
+        // the children which are cached, even if they do not cover the whole tile
+        if (!drawn && found > 0)
         {
-            //load from net, add empty image
-            net->loadImage(host, url);
+            const int half = tilesize/2;
+            for (int i=0; i<4; ++i)
+            {
+                if (!children[i].isNull())
+                {
+                    painter->drawPixmap(QRect(topLeft + QPoint(i%2 * half, i/2 * half), QSize(half, half)), children[i]);
+                }
+            }
+            drawn = true;
         }
-        return emptyPixmap;
+
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, smooth);
+        return drawn;
     }
 
-    QPixmap ImageManager::prefetchImage(const QString& host, const QString& url)
+    QPixmap ImageManager::prefetchImage(const TileKey& tile)
     {
-        // TODO See if this actually helps on the N900 & Symbian Phones
-        #if defined Q_WS_QWS || defined Q_WS_MAEMO_5 || defined Q_WS_S60
-            // on mobile devices we don´t want the display refreshing when tiles are received which are
-            // prefetched... This is a performance issue, because mobile devices are very slow in
-            // repainting the screen
-            prefetch.append(url);
-        #endif
-        return getImage(host, url);
+        return requestImage(tile, true);
     }
 
-    void ImageManager::receivedImage(const QPixmap pixmap, const QString& url)
+    QPixmap ImageManager::requestImage(const TileKey& tile, bool prefetch)
     {
-        //qDebug() << "ImageManager::receivedImage";
-        QPixmapCache::insert(url, pixmap);
+        //qDebug() << "ImageManager::getImage";
+        QPixmap pm;
 
-        //remove from failed list (if exists) as it has now come good
-        if (failedFetches.contains(url))
+        if ( tiles.find(tile, &pm) )
         {
-            failedFetches.remove(url);
+           //image found in cache, use this version, a null one is a local tile which could not be read
+            return pm.isNull() ? emptyPixmap : pm;
         }
 
-        if (!prefetch.contains(url))
+        if ( tile.adapter->hasLocalTiles() )
         {
-            emit imageReceived();
+            // local tiles are read right away, only visible ones are worth decoding on this thread
+            if ( !prefetch )
+            {
+                // a missing or corrupt tile is cached as well, so it is not read again on each paint
+                pm.loadFromData(tile.adapter->tileData(tile.x, tile.y, tile.z));
+                tiles.insert(tile, pm);
+                if ( !pm.isNull() )
+                {
+                    return pm;
+                }
+            }
+            return emptyPixmap;
         }
-        else
+
+        if ( net->imageIsLoading(tile) )
+        {
+            //currently loading an image, a prefetched tile which is needed now moves up in the queue
+            if (!prefetch)
+            {
+                net->raisePriority(tile);
+            }
+            return loadingPixmap;
+        }
+
+        //prevents spamming public servers when requests fail to return an image or server returns error code (busy/ivalid useragent etc)
+        QHash<TileKey, FailedTile>::const_iterator failed = failedTiles.constFind(tile);
+        if ( failed != failedTiles.constEnd() && QDateTime::currentMSecsSinceEpoch() < failed->retryAt )
         {
-            #if defined Q_WS_QWS || defined Q_WS_MAEMO_5 || defined Q_WS_S60
-                prefetch.remove(prefetch.indexOf(url));
-            #endif
+            return emptyPixmap;
         }
+
+        //load from net, add empty image
+        const QString url = tile.adapter->query(tile.x, tile.y, tile.z);
+        net->loadImage(tile.adapter->tileHost(tile.x, tile.y, tile.z), url, tile, prefetch);
+        return emptyPixmap;
+    }
+
+    void ImageManager::receivedImage(const QPixmap pixmap, const TileKey& tile, bool prefetched)
+    {
+        //qDebug() << "ImageManager::receivedImage";
+        tiles.insert(tile, pixmap);
+
+        //remove from failed list (if exists) as it has now come good
+        failedTiles.remove(tile);
+
+        // prefetched tiles are not visible, repainting the map for them would be wasted
+        if (!prefetched)
+        {
+            if (receivedTiles.isEmpty())
+            {
+                QTimer::singleShot(kReceivedTilesIntervalMs, this, SLOT(deliverReceivedTiles()));
+            }
+            receivedTiles.append(tile);
+        }
+    }
+
+    void ImageManager::deliverReceivedTiles()
+    {
+        const QList<TileKey> tiles = receivedTiles;
+        receivedTiles.clear();
+
+        emit tilesReceived(tiles);
+        emit imageReceived();
     }
 
     void ImageManager::loadingQueueEmpty()
@@ -143,6 +245,83 @@ namespace qmapcontrol
         net->abortLoading();
     }
 
+    void ImageManager::setViewport(const MapAdapter* adapter, const QRect& viewport, const QPoint& middle)
+    {
+        if (!adapters.contains(adapter))
+        {
+            // the tiles of a destroyed MapAdapter must not be found by a new one at the same address
+            adapters.insert(adapter);
+            connect(adapter, SIGNAL(destroyed(QObject*)), this, SLOT(adapterDestroyed(QObject*)));
+        }
+
+        // the tiles of the offscreen image stay in memory
+        tiles.pin(adapter, adapter->currentZoom(), adapter->tilesize(), viewport);
+
+        const bool reversedZoom = adapter->maxZoom() < adapter->minZoom();
+        net->setViewport(adapter, adapter->currentZoom(), reversedZoom, adapter->tilesize(), viewport, middle);
+    }
+
+    void ImageManager::adapterDestroyed(QObject* adapter)
+    {
+        adapters.remove(adapter);
+        tiles.remove(adapter);
+
+        QMutableHashIterator<TileKey, FailedTile> it(failedTiles);
+        while (it.hasNext())
+        {
+            if (static_cast<const QObject*>(it.next().key().adapter) == adapter)
+            {
+                it.remove();
+            }
+        }
+        net->removeAdapter(adapter);
+    }
+
+    TileCache* ImageManager::tileCache()
+    {
+        return &tiles;
+    }
+
+    void ImageManager::setPrefetchArea(const MapAdapter* adapter, const QRect& area)
+    {
+        net->setPrefetchArea(adapter, area);
+    }
+
+    void ImageManager::setMaxConnectionsPerHost(int maxConnections)
+    {
+        net->setMaxConnectionsPerHost(maxConnections);
+    }
+
+    void ImageManager::setHttp2Allowed(bool allowed)
+    {
+        net->setHttp2Allowed(allowed);
+    }
+
+    void ImageManager::setStaleWhileRevalidate(bool enabled)
+    {
+        net->setStaleWhileRevalidate(enabled);
+    }
+
+    QHash<QString, int> ImageManager::runningRequestsPerHost() const
+    {
+        return net->runningRequests();
+    }
+
+    QHash<QString, int> ImageManager::queuedRequestsPerHost() const
+    {
+        return net->queuedRequests();
+    }
+
+    void ImageManager::setDecoderThreadCount(int threads)
+    {
+        net->decoder()->setThreadCount(threads);
+    }
+
+    void ImageManager::setConvertToPremultiplied(bool convert)
+    {
+        net->decoder()->setConvertToPremultiplied(convert);
+    }
+
     void ImageManager::setProxy(QString host, int port, const QString username, const QString password)
     {
         net->setProxy(host, port, username, password);
@@ -172,12 +351,63 @@ namespace qmapcontrol
         return net->loadQueueSize();
     }
 
-    void qmapcontrol::ImageManager::fetchFailed(const QString &url)
+    void ImageManager::fetchFailed(const TileKey& tile)
     {
-        qDebug() << "ImageManager::fetchFailed" << url;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (failedTiles.size() >= kMaxFailedTiles && !failedTiles.contains(tile))
+        {
+            pruneFailedTiles(now);
+        }
 
-        //store current time for this failed image to prevent loading it again until
-        failedFetches.insert(url, QDateTime::currentDateTime());
+        //store when this failed image may be loaded again, every failure doubles the delay
+        FailedTile& failed = failedTiles[tile];
+        const int delay = qMin(kFailedTileDelayMs << qMin(failed.failures, 10), kMaxFailedTileDelayMs);
+        ++failed.failures;
+        failed.retryAt = now + delay;
+    }
+
+    void ImageManager::pruneFailedTiles(qint64 now)
+    {
+        // tiles which may be loaded again go first, then the ones which may be loaded soonest
+        QVector<qint64> retries;
+        QMutableHashIterator<TileKey, FailedTile> it(failedTiles);
+        while (it.hasNext())
+        {
+            if (it.next().value().retryAt <= now)
+            {
+                it.remove();
+            }
+            else
+            {
+                retries.append(it.value().retryAt);
+            }
+        }
+
+        if (failedTiles.size() < kMaxFailedTiles)
+        {
+            return;
+        }
+
+        std::sort(retries.begin(), retries.end());
+        const qint64 limit = retries.at(retries.size() - kMaxFailedTiles*3/4);
+        it.toFront();
+        while (it.hasNext())
+        {
+            if (it.next().value().retryAt < limit)
+            {
+                it.remove();
+            }
+        }
+    }
+
+    bool ImageManager::isHostAvailable(const QString& host) const
+    {
+        return net->isHostAvailable(host);
+    }
+
+    void ImageManager::hostAvailabilityChanged(const QString& host, bool available)
+    {
+        emit hostAvailable(host, available);
     }
 
 }
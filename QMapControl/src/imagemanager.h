@@ -28,18 +28,22 @@
 
 #include "qmapcontrol_global.h"
 #include <QObject>
-#include <QPixmapCache>
 #include <QDebug>
 #include <QMutex>
 #include <QFile>
 #include <QDateTime>
 #include <QBuffer>
 #include <QDir>
+#include <QRect>
+#include <QSet>
 #include <QNetworkDiskCache>
+#include "tilekey.h"
+#include "tilecache.h"
 
 namespace qmapcontrol
 {
     class MapNetwork;
+    class MapAdapter;
     /**
     @author Kai Winter <kaiwinter@gmx.de>
      */
@@ -54,16 +58,51 @@ namespace qmapcontrol
         //! returns a QPixmap of the asked image
         /*!
          * If this component doesnt have the image a network query gets started to load it.
-         * @param host the host of the image
-         * @param path the path to the image
+         * The host and path of the image are formed by the MapAdapter of the tile.
+         * @param tile the key of the tile
          * @return the pixmap of the asked image
          */
-        QPixmap getImage(const QString& host, const QString& path);
+        QPixmap getImage(const TileKey& tile);
 
-        QPixmap prefetchImage(const QString& host, const QString& path);
+        //! draws the image of a tile, or a placeholder while it is missing
+        /*!
+         * A missing tile is requested like with getImage(). Meanwhile it is replaced by the cached
+         * tiles of the next zoom level, scaled down, or by the part of a cached tile of up to
+         * four zoom levels above, scaled up. Only if none is cached the loading image is drawn.
+         * @param painter the painter to draw with
+         * @param topLeft the position of the tile
+         * @param tile the key of the tile
+         * @return true if the tile itself was drawn, false for a placeholder
+         */
+        bool drawImage(QPainter* painter, const QPoint& topLeft, const TileKey& tile);
+
+        //! loads an image which is not visible yet
+        /*!
+         * Prefetched images are loaded after all visible ones and do not trigger a repaint when they arrive.
+         * @param tile the key of the tile
+         * @return the pixmap of the asked image
+         */
+        QPixmap prefetchImage(const TileKey& tile);
+
+        void receivedImage(const QPixmap pixmap, const TileKey& tile, bool prefetched = false);
 
-        void receivedImage(const QPixmap pixmap, const QString& url);
-        void fetchFailed(const QString &url);
+        //! called by MapNetwork when a tile could not be loaded
+        /*!
+         * The tile is not requested again for a while. The delay starts at 5 seconds and doubles
+         * with each further failure up to 30 minutes. At most 4096 failed tiles are remembered.
+         * @param tile the key of the tile
+         */
+        void fetchFailed(const TileKey& tile);
+
+        //! called by MapNetwork when a host failed or works again
+        void hostAvailabilityChanged(const QString& host, bool available);
+
+        //! returns false while tiles are not requested from a host because its requests failed
+        /*!
+         * @param host the host as given by the MapAdapter
+         * @return true if the host is requested
+         */
+        bool isHostAvailable(const QString& host) const;
 
         /*!
          * This method is called by MapNetwork, after all images in its queue were loaded.
@@ -79,6 +118,76 @@ namespace qmapcontrol
          */
         void abortLoading();
 
+        //! sets the viewport for which the tiles of a MapAdapter are needed
+        /*!
+         * Queued tiles are loaded in order of their distance to the given middle.
+         * Loading tiles outside of the viewport or of another zoom level are cancelled.
+         * @param adapter the MapAdapter of the tiles
+         * @param viewport the offscreen viewport in display coordinates
+         * @param middle the middle of the map in display coordinates
+         */
+        void setViewport(const MapAdapter* adapter, const QRect& viewport, const QPoint& middle);
+
+        //! sets the area in which prefetched tiles of a MapAdapter are still needed
+        /*!
+         * Prefetched tiles which are neither in the area nor cover it from a neighbour zoom level are cancelled.
+         * @param adapter the MapAdapter of the tiles
+         * @param area the prefetch area in display coordinates
+         */
+        void setPrefetchArea(const MapAdapter* adapter, const QRect& area);
+
+        //! returns the memory cache of the tiles
+        /*!
+         * The cache can be used to set the memory budget and quotas of the map layers and to read its statistics.
+         * @return the tile cache
+         */
+        TileCache* tileCache();
+
+        //! sets how many tiles are loaded from one host at the same time
+        /*!
+         * @param maxConnections the number of parallel requests per host, default is 6
+         */
+        void setMaxConnectionsPerHost(int maxConnections);
+
+        //! allows HTTP/2 for the tile requests, if Qt and the tile server support it
+        /*!
+         * @param allowed true to allow HTTP/2, default is true
+         */
+        void setHttp2Allowed(bool allowed);
+
+        //! shows tiles of the persistent cache right away, even if they expired
+        /*!
+         * Expired tiles are checked for changes afterwards and only replaced if the server sends a new tile.
+         * @param enabled true to show expired tiles, default is false
+         */
+        void setStaleWhileRevalidate(bool enabled);
+
+        //! returns the number of running requests for each host
+        /*!
+         * The hosts are given as "scheme://host:port". Hosts without running requests are left out.
+         * @return the running requests per host
+         */
+        QHash<QString, int> runningRequestsPerHost() const;
+
+        //! returns the number of tiles which wait for a free connection for each host
+        /*!
+         * @return the queued requests per host
+         */
+        QHash<QString, int> queuedRequestsPerHost() const;
+
+        //! sets the number of threads which decode the downloaded tiles
+        /*!
+         * @param threads the number of decoding threads, default is one less than the number of cores
+         */
+        void setDecoderThreadCount(int threads);
+
+        //! sets whether decoded tiles are converted to a premultiplied format by the decoding threads
+        /*!
+         * This saves the conversion when the tile is painted. It is enabled by default.
+         * @param convert true to convert the decoded tiles
+         */
+        void setConvertToPremultiplied(bool convert);
+
         //! sets the proxy for HTTP connections
         /*!
          * This method sets the proxy for HTTP connections.
@@ -106,17 +215,56 @@ namespace qmapcontrol
     private:        
         Q_DISABLE_COPY( ImageManager )
 
+        QPixmap requestImage(const TileKey& tile, bool prefetch);
+        bool drawPlaceholder(QPainter* painter, const QPoint& topLeft, const TileKey& tile) const;
+
         QPixmap emptyPixmap;
         QPixmap loadingPixmap;
 
         MapNetwork* net;
         QNetworkDiskCache* diskCache;
-        QVector<QString> prefetch;
 
-        QHash<QString,QDateTime> failedFetches;        
+        struct FailedTile
+        {
+            FailedTile() : failures(0), retryAt(0)
+            {
+            }
+
+            int failures;
+            qint64 retryAt; // msecs since epoch
+        };
+
+        void pruneFailedTiles(qint64 now);
+
+        QHash<TileKey, FailedTile> failedTiles;
+
+        TileCache tiles;
+        QSet<const QObject*> adapters; // MapAdapters whose destruction is watched
+
+        // tiles received since the last tilesReceived() signal
+        QList<TileKey> receivedTiles;
+
+    private slots:
+        void deliverReceivedTiles();
+        void adapterDestroyed(QObject* adapter);
 
     signals:
         void imageReceived();
+
+        //! emitted at most once per frame with all tiles which were received meanwhile
+        /*!
+         * Prefetched tiles are not reported.
+         * @param tiles the received tiles
+         */
+        void tilesReceived(const QList<TileKey>& tiles);
+
+        //! emitted when a host fails or works again
+        /*!
+         * While a host is not available its tiles stay queued, a single request probes it from time to time.
+         * @param host the host as "scheme://host:port"
+         * @param available false if the host is not requested anymore, true if it works again
+         */
+        void hostAvailable(const QString& host, bool available);
         void loadingFinished();
     };
 }
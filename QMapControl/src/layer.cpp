@@ -24,14 +24,56 @@
 */
 
 #include "layer.h"
+#include <QPair>
+#include <QVector>
+#include <algorithm>
+
+namespace
+{
+    // widgets are moved instead of drawn, so they have to be placed wherever they are
+    qmapcontrol::Point* widgetPoint(qmapcontrol::Geometry* geometry)
+    {
+        if (geometry->GeometryType != "Point")
+        {
+            return 0;
+        }
+        qmapcontrol::Point* point = dynamic_cast<qmapcontrol::Point*>(geometry);
+        return point != 0 && point->widget() != 0 ? point : 0;
+    }
+
+    // the top left of a bounding box is the minimum and the bottom right the maximum coordinate
+    QRectF uniteBoxes(const QRectF& a, const QRectF& b)
+    {
+        return QRectF(QPointF(qMin(a.left(), b.left()), qMin(a.top(), b.top())),
+                      QPointF(qMax(a.right(), b.right()), qMax(a.bottom(), b.bottom())));
+    }
+
+    // true if the box is within the other one and touches its border, so it may define it
+    bool onBorder(const QRectF& box, const QRectF& rect)
+    {
+        const bool within = rect.left() >= box.left() && rect.right() <= box.right()
+                         && rect.top() >= box.top() && rect.bottom() <= box.bottom();
+        return within && (rect.left() == box.left() || rect.right() == box.right()
+                       || rect.top() == box.top() || rect.bottom() == box.bottom());
+    }
+}
+
 namespace qmapcontrol
 {
     Layer::Layer()
         :   visible(true),
             mylayertype(MapLayer),
+            firstOrder(0),
+            lastOrder(0),
+            indexZoom(0),
+            indexValid(false),
+            geometriesBoxValid(false),
+            borderGeometry(0),
             mapAdapter(0),
             takeevents(true),
             myoffscreenViewport(QRect(0,0,0,0)),
+            cacheStatic(false),
+            staticZoom(0),
             m_ImageManager(0)
     {
     }
@@ -39,9 +81,17 @@ namespace qmapcontrol
         :   visible(true),
             mylayername(layername),
             mylayertype(layertype),
+            firstOrder(0),
+            lastOrder(0),
+            indexZoom(0),
+            indexValid(false),
+            geometriesBoxValid(false),
+            borderGeometry(0),
             mapAdapter(mapadapter),
             takeevents(takeevents),
             myoffscreenViewport(QRect(0,0,0,0)),
+            cacheStatic(false),
+            staticZoom(0),
             m_ImageManager(0)
     {
     }
@@ -85,28 +135,39 @@ namespace qmapcontrol
 
     bool Layer::containsGeometry( Geometry* geometry )
     {
-        return geometry && geometries.contains( geometry );
+        return geometry && drawOrder.contains( geometry );
+    }
+
+    QList<Geometry*> Layer::geometriesInRect(const QRectF& rect) const
+    {
+        const QRect area = QRect(mapAdapter->coordinateToDisplay(rect.topLeft()),
+                                 mapAdapter->coordinateToDisplay(rect.bottomRight())).normalized();
+        return geometriesIn(area, true);
     }
 
     void Layer::sendGeometryToFront(Geometry *geometry)
     {
-        if ( !geometry || !geometries.contains( geometry ) )
+        if ( !geometry || !drawOrder.contains( geometry ) )
         {
             return;
         }
         geometries.removeAll(geometry);
         geometries.prepend(geometry);
+        drawOrder.insert(geometry, --firstOrder);
+        invalidateStaticGeometries();
         emit(updateRequest());
     }
 
     void Layer::sendGeometryToBack(Geometry *geometry)
     {
-        if ( !geometry || !geometries.contains( geometry ) )
+        if ( !geometry || !drawOrder.contains( geometry ) )
         {
             return;
         }
         geometries.removeAll(geometry);
         geometries.append(geometry);
+        drawOrder.insert(geometry, ++lastOrder);
+        invalidateStaticGeometries();
         emit(updateRequest());
     }
 
@@ -118,10 +179,98 @@ namespace qmapcontrol
         }
 
         geometries.append(geom);
-        emit(updateRequest(geom->boundingBox()));
+        drawOrder.insert(geom, ++lastOrder);
+        Point* point = widgetPoint(geom);
+        if (point != 0)
+        {
+            widgetPoints.append(point);
+        }
+
+        // without a MapAdapter there are no display coordinates, the index is built once it is set
+        const QRect rect = mapAdapter != 0 ? geom->displayBoundingBox(mapAdapter) : QRect();
+        indexGeometry(geom, rect);
+        if (geometriesBoxValid && geometries.size() > 1)
+        {
+            geometriesBox = uniteBoxes(geometriesBox, geom->boundingBox());
+        }
+        else
+        {
+            geometriesBoxValid = false;
+        }
+        if (!geom->isDynamic())
+        {
+            invalidateStaticGeometries(rect);
+        }
+        emit(geometryUpdateRequest(rect));
         //a geometry can request a redraw, e.g. when its position has been changed
+        connect(geom, SIGNAL(updateRequest(Geometry*)),
+                this, SLOT(geometryChanged(Geometry*)));
         connect(geom, SIGNAL(updateRequest(QRectF)),
-                this, SIGNAL(updateRequest(QRectF)));
+                this, SLOT(geometryAreaChanged(QRectF)));
+    }
+
+    void Layer::geometryChanged(Geometry* geom)
+    {
+        const QRect rect = mapAdapter != 0 ? geom->displayBoundingBox(mapAdapter) : QRect();
+        indexGeometry(geom, rect);
+        updateBoundingBox(geom);
+        if (!geom->isDynamic())
+        {
+            invalidateStaticGeometries(rect);
+        }
+        emit(geometryUpdateRequest(rect));
+    }
+
+    void Layer::geometryAreaChanged(QRectF rect)
+    {
+        // custom geometries may only announce the changed area
+        Geometry* geom = qobject_cast<Geometry*>(sender());
+        if (geom != 0 && drawOrder.contains(geom))
+        {
+            indexGeometry(geom, mapAdapter != 0 ? geom->displayBoundingBox(mapAdapter) : QRect());
+            updateBoundingBox(geom);
+        }
+        emit(updateRequest(rect));
+    }
+
+    void Layer::updateBoundingBox(Geometry* geometry)
+    {
+        // geometries announce a change before and after it: a geometry which has left the border
+        // may shrink the box, afterwards a geometry can only extend it
+        const QRectF box = geometry->boundingBox();
+        if (geometry == borderGeometry && box != borderBox)
+        {
+            geometriesBoxValid = false;
+            borderGeometry = 0;
+        }
+
+        if (!geometriesBoxValid || onBorder(geometriesBox, box))
+        {
+            // the box may be built before the geometry announces the end of the change
+            borderGeometry = geometry;
+            borderBox = box;
+        }
+        else
+        {
+            geometriesBox = uniteBoxes(geometriesBox, box);
+        }
+    }
+
+    QRectF Layer::boundingBox() const
+    {
+        if (geometriesBoxValid)
+        {
+            return geometriesBox;
+        }
+
+        geometriesBox = QRectF();
+        for (int i=0; i<geometries.size(); ++i)
+        {
+            const QRectF box = geometries.at(i)->boundingBox();
+            geometriesBox = i == 0 ? box : uniteBoxes(geometriesBox, box);
+        }
+        geometriesBoxValid = true;
+        return geometriesBox;
     }
 
     void Layer::removeGeometry(Geometry* geometry, bool qDeleteObject)
@@ -131,7 +280,27 @@ namespace qmapcontrol
             return;
         }
 
-        QRectF boundingBox = geometry->boundingBox();
+        const QRect boundingBox = mapAdapter != 0 ? geometry->displayBoundingBox(mapAdapter) : QRect();
+        if (!geometry->isDynamic())
+        {
+            invalidateStaticGeometries(boundingBox);
+        }
+        if (geometriesBoxValid && drawOrder.contains(geometry) && onBorder(geometriesBox, geometry->boundingBox()))
+        {
+            geometriesBoxValid = false;
+        }
+
+        if (borderGeometry == geometry)
+        {
+            borderGeometry = 0;
+        }
+        drawOrder.remove(geometry);
+        geometryIndex.remove(geometry);
+        Point* point = widgetPoint(geometry);
+        if (point != 0)
+        {
+            widgetPoints.removeAll(point);
+        }
 
         foreach( Geometry* geo, geometries )
         {
@@ -146,7 +315,7 @@ namespace qmapcontrol
                 }
             }
         }
-        emit(updateRequest(boundingBox));
+        emit(geometryUpdateRequest(boundingBox));
     }
 
     void Layer::clearGeometries( bool qDeleteObject )
@@ -161,6 +330,12 @@ namespace qmapcontrol
             }
         }
         geometries.clear();
+        drawOrder.clear();
+        widgetPoints.clear();
+        geometryIndex.clear();
+        geometriesBoxValid = false;
+        borderGeometry = 0;
+        invalidateStaticGeometries();
     }
 
     bool Layer::isVisible() const
@@ -185,12 +360,12 @@ namespace qmapcontrol
                  evnt->type() == QEvent::MouseButtonPress)
             {
                 // check for collision
-                QPointF c = mapAdapter->displayToCoordinate(QPoint(evnt->x()-screenmiddle.x()+mapmiddle_px.x(),
-                                                                   evnt->y()-screenmiddle.y()+mapmiddle_px.y()));
+                const QPoint click = QPoint(evnt->x()-screenmiddle.x()+mapmiddle_px.x(),
+                                            evnt->y()-screenmiddle.y()+mapmiddle_px.y());
+                QPointF c = mapAdapter->displayToCoordinate(click);
                 Point* tmppoint = new Point(c.x(), c.y());
-                for(QList<Geometry*>::const_iterator iter = geometries.begin(); iter != geometries.end(); ++iter)
+                foreach (Geometry* geo, geometriesIn(QRect(click, QSize(1, 1)), true))
                 {
-                    Geometry *geo = *iter;
                     if (geo && geo->isVisible() && geo->Touches(tmppoint, mapAdapter))
                     {
                         emit(geometryClicked(geo, QPoint(evnt->x(), evnt->y())));
@@ -206,6 +381,12 @@ namespace qmapcontrol
         return takeevents;
     }
 
+    bool Layer::hasTiles() const
+    {
+        // the EmptyMapAdapter has neither a server nor local tiles
+        return mapAdapter->hasLocalTiles() || !mapAdapter->host().isEmpty();
+    }
+
     void Layer::drawYourImage(QPainter* painter, const QPoint mapmiddle_px) const
     {
         if (mylayertype == MapLayer)
@@ -229,15 +410,150 @@ namespace qmapcontrol
 
         painter->translate(-mapmiddle_px+screenmiddle);
 
-        for(QList<Geometry*>::const_iterator iter = geometries.begin(); iter != geometries.end(); ++iter)
+        foreach (Geometry* geo, geometriesIn(viewport, false))
         {
-            Geometry *geo = *iter;
             geo->draw(painter, mapAdapter, viewport, offset);
         }
+        foreach (Point* point, widgetPoints)
+        {
+            point->draw(painter, mapAdapter, viewport, offset);
+        }
         painter->translate(mapmiddle_px-screenmiddle);
 
     }
 
+    void Layer::drawCachedGeometries(QPainter* painter, const QPoint mapmiddle_px, const QRect& area, const QRect& viewport) const
+    {
+        // the cache covers the offscreen viewport of the map, anything else needs a new one
+        const int zoom = mapAdapter->currentZoom();
+        if (staticImage.isNull() || area != staticArea || zoom != staticZoom)
+        {
+            // a pixmap has an alpha channel only once it was filled with a transparent color
+            staticImage = QPixmap(area.size());
+            staticImage.fill(Qt::transparent);
+            staticArea = area;
+            staticZoom = zoom;
+            staticDirty = QRegion(area);
+        }
+
+        const QPoint offset = mapmiddle_px-screenmiddle;
+        if (!staticDirty.isEmpty())
+        {
+            const QRect dirty = staticDirty.boundingRect();
+            QPainter cachePainter(&staticImage);
+            cachePainter.translate(-area.topLeft());
+            cachePainter.setClipRegion(staticDirty);
+            cachePainter.setCompositionMode(QPainter::CompositionMode_Source);
+            cachePainter.fillRect(dirty, Qt::transparent);
+            cachePainter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            foreach(Geometry* geo, geometriesIn(dirty, false))
+            {
+                if (!geo->isDynamic())
+                {
+                    geo->draw(&cachePainter, mapAdapter, dirty, offset);
+                }
+            }
+            cachePainter.end();
+            staticDirty = QRegion();
+        }
+
+        painter->drawPixmap(area.topLeft() - offset, staticImage);
+
+        painter->translate(-offset);
+        foreach(Geometry* geo, geometriesIn(viewport, false))
+        {
+            if (geo->isDynamic())
+            {
+                geo->draw(painter, mapAdapter, viewport, offset);
+            }
+        }
+        foreach (Point* point, widgetPoints)
+        {
+            point->draw(painter, mapAdapter, viewport, offset);
+        }
+        painter->translate(offset);
+    }
+
+    QList<Geometry*> Layer::geometriesIn(const QRect& rect, bool widgets) const
+    {
+        updateGeometryIndex();
+
+        QList<Geometry*> found = geometryIndex.intersecting(rect);
+        if (widgets)
+        {
+            foreach (Point* point, widgetPoints)
+            {
+                if (point->displayBoundingBox(mapAdapter).intersects(rect))
+                {
+                    found.append(point);
+                }
+            }
+        }
+
+        // the index doesn't keep the order, which decides what is drawn on top
+        QVector<QPair<qint64, Geometry*> > sorted;
+        sorted.reserve(found.size());
+        foreach (Geometry* geometry, found)
+        {
+            sorted.append(qMakePair(drawOrder.value(geometry), geometry));
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        QList<Geometry*> result;
+        result.reserve(sorted.size());
+        for (int i=0; i<sorted.size(); ++i)
+        {
+            result.append(sorted.at(i).second);
+        }
+        return result;
+    }
+
+    void Layer::updateGeometryIndex() const
+    {
+        // display coordinates change with the zoom
+        const int zoom = mapAdapter->currentZoom();
+        if (indexValid && zoom == indexZoom)
+        {
+            return;
+        }
+
+        geometryIndex.clear();
+        foreach (Geometry* geometry, geometries)
+        {
+            if (widgetPoint(geometry) == 0)
+            {
+                geometryIndex.insert(geometry, geometry->displayBoundingBox(mapAdapter));
+            }
+        }
+        indexZoom = zoom;
+        indexValid = true;
+    }
+
+    void Layer::indexGeometry(Geometry* geometry, const QRect& rect)
+    {
+        if (mapAdapter == 0 || !indexValid || mapAdapter->currentZoom() != indexZoom)
+        {
+            // the index is built again at the next lookup
+            indexValid = false;
+        }
+        else if (widgetPoint(geometry) == 0)
+        {
+            geometryIndex.insert(geometry, rect);
+        }
+    }
+
+    void Layer::invalidateStaticGeometries(const QRect& rect) const
+    {
+        if (rect.isNull())
+        {
+            staticImage = QPixmap();
+        }
+        else if (!staticImage.isNull())
+        {
+            staticDirty += rect.intersected(staticArea);
+        }
+    }
+
     void Layer::_draw(QPainter* painter, const QPoint mapmiddle_px) const
     {
         if ( m_ImageManager == 0 )
@@ -245,6 +561,47 @@ namespace qmapcontrol
             return;
         }
 
+        updateViewport(mapmiddle_px);
+
+        // for the EmptyMapAdapter no tiles should be loaded and painted.
+        if (!hasTiles())
+        {
+            return;
+        }
+
+        const int tilesize = mapAdapter->tilesize();
+        const int zoom = mapAdapter->currentZoom();
+        const int mapmiddle_tile_x = mapmiddle_px.x()/tilesize;
+        const int mapmiddle_tile_y = mapmiddle_px.y()/tilesize;
+
+        // the offscreen image starts one screen left and above of the middle
+        const QPoint origin = mapmiddle_px - QPoint(size.width(), size.height());
+
+        //grab the middle tile (under the pointer) first
+        if (mapAdapter->isTileValid(mapmiddle_tile_x, mapmiddle_tile_y, zoom))
+        {
+            m_ImageManager->drawImage(painter,
+                                      QPoint(mapmiddle_tile_x*tilesize, mapmiddle_tile_y*tilesize) - origin,
+                                      TileKey(mapAdapter, mapmiddle_tile_x, mapmiddle_tile_y, zoom));
+        }
+
+        // the viewport is aligned to the tiles, its right and bottom edge belong to the next tile
+        for (int i=myoffscreenViewport.left()/tilesize; i<myoffscreenViewport.right()/tilesize; ++i)
+        {
+            for (int j=myoffscreenViewport.top()/tilesize; j<myoffscreenViewport.bottom()/tilesize; ++j)
+            {
+                // check if image is valid
+                if (!(i==mapmiddle_tile_x && j==mapmiddle_tile_y) && mapAdapter->isTileValid(i, j, zoom))
+                {
+                    m_ImageManager->drawImage(painter, QPoint(i*tilesize, j*tilesize) - origin,
+                                              TileKey(mapAdapter, i, j, zoom));
+                }
+            }
+        }
+    }
+
+    void Layer::updateViewport(const QPoint mapmiddle_px) const
+    {
         // screen middle...
         int tilesize = mapAdapter->tilesize();
         int cross_x = int(mapmiddle_px.x())%tilesize; // position on middle tile
@@ -271,7 +628,6 @@ namespace qmapcontrol
         if (space_bottom>0)
             tiles_bottom+=1;
 
-        //int tiles_displayed = 0;
         int mapmiddle_tile_x = mapmiddle_px.x()/tilesize;
         int mapmiddle_tile_y = mapmiddle_px.y()/tilesize;
 
@@ -280,68 +636,121 @@ namespace qmapcontrol
 
         myoffscreenViewport = QRect(from, to);
 
-        // for the EmptyMapAdapter no tiles should be loaded and painted.
-        if (mapAdapter->host().isEmpty())
+        // loads tiles from the middle outwards and drops the ones which were scrolled out
+        if (m_ImageManager != 0 && hasTiles())
+        {
+            m_ImageManager->setViewport(mapAdapter, myoffscreenViewport, mapmiddle_px);
+        }
+    }
+
+    void Layer::drawTiles(QPainter* painter, const QPoint mapmiddle_px, const QRect& rect) const
+    {
+        if ( m_ImageManager == 0 || !hasTiles() )
         {
             return;
         }
 
-        //grab the middle tile (under the pointer) first
-        if (mapAdapter->isTileValid(mapmiddle_tile_x, mapmiddle_tile_y, mapAdapter->currentZoom()))
+        // the offscreen image starts one screen left and above of the middle, see _draw()
+        const QPoint origin = mapmiddle_px - QPoint(size.width(), size.height());
+        const QRect area = rect.translated(origin).intersected(myoffscreenViewport);
+        if ( area.isEmpty() )
         {
-                painter->drawPixmap(-cross_x+size.width(),
-                                    -cross_y+size.height(),
-                                    m_ImageManager->getImage(mapAdapter->host(), mapAdapter->query(mapmiddle_tile_x, mapmiddle_tile_y, mapAdapter->currentZoom())) );
+            return;
         }
 
-        for (int i=-tiles_left+mapmiddle_tile_x; i<=tiles_right+mapmiddle_tile_x; ++i)
+        const int tilesize = mapAdapter->tilesize();
+        const int zoom = mapAdapter->currentZoom();
+        for (int i=tileIndex(area.left(), tilesize); i<=tileIndex(area.right(), tilesize); ++i)
         {
-            for (int j=-tiles_above+mapmiddle_tile_y; j<=tiles_bottom+mapmiddle_tile_y; ++j)
+            for (int j=tileIndex(area.top(), tilesize); j<=tileIndex(area.bottom(), tilesize); ++j)
             {
-                // check if image is valid
-                if (!(i==mapmiddle_tile_x && j==mapmiddle_tile_y))
+                if (mapAdapter->isTileValid(i, j, zoom))
                 {
-                    if (mapAdapter->isTileValid(i, j, mapAdapter->currentZoom()))
-                    {
-                        painter->drawPixmap(((i-mapmiddle_tile_x)*tilesize)-cross_x+size.width(),
-                                                ((j-mapmiddle_tile_y)*tilesize)-cross_y+size.height(),
-                                                m_ImageManager->getImage(mapAdapter->host(), mapAdapter->query(i, j, mapAdapter->currentZoom())));
-                    }
+                    m_ImageManager->drawImage(painter, QPoint(i*tilesize - origin.x(), j*tilesize - origin.y()),
+                                              TileKey(mapAdapter, i, j, zoom));
                 }
             }
         }
 
-        bool enabledPrefetch = false;
-        if ( enabledPrefetch )
+        drawYourGeometries(painter, QPoint(mapmiddle_px.x()-screenmiddle.x(), mapmiddle_px.y()-screenmiddle.y()), myoffscreenViewport);
+    }
+
+    bool Layer::drawTile(QPainter* painter, const QPoint& topLeft, int x, int y) const
+    {
+        const int zoom = mapAdapter->currentZoom();
+        if ( m_ImageManager == 0 || !mapAdapter->isTileValid(x, y, zoom) )
+        {
+            // nothing to draw is final as well
+            return true;
+        }
+        return m_ImageManager->drawImage(painter, topLeft, TileKey(mapAdapter, x, y, zoom));
+    }
+
+    void Layer::prefetchTiles(const QPoint mapmiddle_px, const QPoint predicted_px, int ring, bool zoomLevels) const
+    {
+        if ( m_ImageManager == 0 || !hasTiles() )
+        {
+            return;
+        }
+
+        if ( ring <= 0 && !zoomLevels )
         {
-            // Prefetch the next set of rows/column tiles (ready for when the user starts panning).
-            const int prefetch_tile_left = tiles_left - 1;
-            const int prefetch_tile_top = tiles_above - 1;
-            const int prefetch_tile_right = tiles_right + 1;
-            const int prefetch_tile_bottom = tiles_bottom + 1;
+            m_ImageManager->setPrefetchArea(mapAdapter, QRect());
+            return;
+        }
+
+        const int tilesize = mapAdapter->tilesize();
+        const int zoom = mapAdapter->currentZoom();
+        const QRect screen = QRect(mapmiddle_px - screenmiddle, size);
+
+        // the screen where the map is expected to be scrolled to, plus the ring around both
+        const int border = qMax(0, ring) * tilesize;
+        const QRect area = screen.united(QRect(predicted_px - screenmiddle, size))
+                                 .adjusted(-border, -border, border, border);
+        m_ImageManager->setPrefetchArea(mapAdapter, area);
+
+        if ( ring > 0 )
+        {
+            prefetchTilesIn(area, zoom);
+        }
 
-            // Fetch the top/bottom rows
-            for (int i=prefetch_tile_left; i<=prefetch_tile_right; ++i)
+        if ( zoomLevels )
+        {
+            // zooming keeps the middle, so the neighbour zoom levels need the screen around the scaled middle
+            const bool reversed = mapAdapter->maxZoom() < mapAdapter->minZoom();
+            const int detailed = reversed ? zoom - 1 : zoom + 1;
+            const int overview = reversed ? zoom + 1 : zoom - 1;
+
+            if ( reversed ? detailed >= mapAdapter->maxZoom() : detailed <= mapAdapter->maxZoom() )
             {
-                if (mapAdapter->isTileValid(i, prefetch_tile_top, mapAdapter->currentZoom()))
-                {
-                    m_ImageManager->prefetchImage(mapAdapter->host(), mapAdapter->query(i, prefetch_tile_top, mapAdapter->currentZoom()));
-                }
-                if (mapAdapter->isTileValid(i, prefetch_tile_bottom, mapAdapter->currentZoom()))
-                {
-                    m_ImageManager->prefetchImage(mapAdapter->host(), mapAdapter->query(i, prefetch_tile_bottom, mapAdapter->currentZoom()));
-                }
+                prefetchTilesIn(QRect(mapmiddle_px*2 - screenmiddle, size), detailed);
             }
+            if ( reversed ? overview <= mapAdapter->minZoom() : overview >= mapAdapter->minZoom() )
+            {
+                prefetchTilesIn(QRect(mapmiddle_px/2 - screenmiddle, size), overview);
+            }
+        }
+    }
+
+    void Layer::prefetchTilesIn(const QRect& area, int zoom) const
+    {
+        const int tilesize = mapAdapter->tilesize();
+        const bool currentZoom = (zoom == mapAdapter->currentZoom());
 
-            for (int i=prefetch_tile_top; i<=prefetch_tile_bottom; ++i)
+        for (int i=tileIndex(area.left(), tilesize); i<=tileIndex(area.right(), tilesize); ++i)
+        {
+            for (int j=tileIndex(area.top(), tilesize); j<=tileIndex(area.bottom(), tilesize); ++j)
             {
-                if (mapAdapter->isTileValid(prefetch_tile_left, i, mapAdapter->currentZoom()))
+                // tiles of the offscreen image were already requested by _draw()
+                if ( currentZoom &&
+                     myoffscreenViewport.contains(QPoint(i*tilesize + tilesize/2, j*tilesize + tilesize/2)) )
                 {
-                    m_ImageManager->prefetchImage(mapAdapter->host(), mapAdapter->query(prefetch_tile_left, i, mapAdapter->currentZoom()));
+                    continue;
                 }
-                if (mapAdapter->isTileValid(prefetch_tile_right, i, mapAdapter->currentZoom()))
+
+                if (mapAdapter->isTileValid(i, j, zoom))
                 {
-                    m_ImageManager->prefetchImage(mapAdapter->host(), mapAdapter->query(prefetch_tile_right, i, mapAdapter->currentZoom()));
+                    m_ImageManager->prefetchImage(TileKey(mapAdapter, i, j, zoom));
                 }
             }
         }
@@ -354,17 +763,10 @@ namespace qmapcontrol
 
     void Layer::moveWidgets(const QPoint mapmiddle_px) const
     {
-        foreach( Geometry* geometry, geometries )
+        foreach( Point* point, widgetPoints )
         {
-            if (geometry->GeometryType == "Point")
-            {
-                Point* point = dynamic_cast<Point*>(geometry);
-                if (point !=0)
-                {
-                    QPoint topleft_relative = QPoint(mapmiddle_px-screenmiddle);
-                    point->drawWidget(mapAdapter, topleft_relative);
-                }
-            }
+            QPoint topleft_relative = QPoint(mapmiddle_px-screenmiddle);
+            point->drawWidget(mapAdapter, topleft_relative);
         }
     }
 
@@ -376,6 +778,8 @@ namespace qmapcontrol
     void Layer::setMapAdapter(MapAdapter* mapadapter)
     {
         mapAdapter = mapadapter;
+        indexValid = false;
+        invalidateStaticGeometries();
         emit(updateRequest());
     }
 
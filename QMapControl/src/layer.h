@@ -36,6 +36,7 @@
 #include "layermanager.h"
 #include "imagemanager.h"
 #include "geometry.h"
+#include "geometryindex.h"
 #include "point.h"
 
 #include "wmsmapadapter.h"
@@ -64,6 +65,7 @@ namespace qmapcontrol
 
     public:
         friend class LayerManager;
+        friend class GeometryLayer;
 
         //! sets the type of a layer, see Layer class doc for further information
         enum LayerType
@@ -132,6 +134,7 @@ namespace qmapcontrol
         //! returns all Geometry objects from this Layer
         /*!
          * This method removes all Geometry objects from this Layer.
+         * Changing the list directly bypasses the spatial index of the Layer, use addGeometry() and removeGeometry().
          * @return a list of geometries that are on this Layer
          */
         QList<Geometry*>& getGeometries();
@@ -142,6 +145,24 @@ namespace qmapcontrol
          */
         bool containsGeometry( Geometry* geometry );
 
+        //! returns the geometries which are drawn within an area
+        /*!
+         * The area is compared with the Geometry::displayBoundingBox() at the current zoom, so pens and pixmaps
+         * count as well. The geometries are looked up in a spatial index, which follows the changes that
+         * geometries announce with Geometry::updateRequest().
+         * @param rect the area in world coordinates
+         * @return the geometries in the order they are drawn, visible or not
+         */
+        QList<Geometry*> geometriesInRect(const QRectF& rect) const;
+
+        //! returns the bounding box of all geometries of this Layer
+        /*!
+         * The box is cached and follows the added and changed geometries, it is only computed again
+         * after a geometry on its border has changed or was removed.
+         * @return the rect that contains the Geometry::boundingBox() of all geometries, visible or not
+         */
+        QRectF boundingBox() const;
+
         //! allow moving a geometry to the top of the list (drawing last)
         /*!
          * This method re-order the Geometry objects so the desired
@@ -176,13 +197,25 @@ namespace qmapcontrol
         void moveWidgets(const QPoint mapmiddle_px) const;
         void drawYourImage(QPainter* painter, const QPoint mapmiddle_px) const;
         void drawYourGeometries(QPainter* painter, const QPoint mapmiddle_px, QRect viewport) const;
+        void drawCachedGeometries(QPainter* painter, const QPoint mapmiddle_px, const QRect& area, const QRect& viewport) const;
+        void invalidateStaticGeometries(const QRect& rect = QRect()) const;
+        QList<Geometry*> geometriesIn(const QRect& rect, bool widgets) const;
+        void updateGeometryIndex() const;
+        void indexGeometry(Geometry* geometry, const QRect& rect);
+        void updateBoundingBox(Geometry* geometry);
         void setSize(QSize size);
         QRect offscreenViewport() const;
+        bool hasTiles() const;
         bool takesMouseEvents() const;
         void mouseEvent(const QMouseEvent*, const QPoint mapmiddle_px);
         void zoomIn() const;
         void zoomOut() const;
         void _draw(QPainter* painter, const QPoint mapmiddle_px) const;
+        void updateViewport(const QPoint mapmiddle_px) const;
+        void drawTiles(QPainter* painter, const QPoint mapmiddle_px, const QRect& rect) const;
+        bool drawTile(QPainter* painter, const QPoint& topLeft, int x, int y) const;
+        void prefetchTiles(const QPoint mapmiddle_px, const QPoint predicted_px, int ring, bool zoomLevels) const;
+        void prefetchTilesIn(const QRect& area, int zoom) const;
 
         bool visible;
         QString mylayername;
@@ -191,10 +224,28 @@ namespace qmapcontrol
         QPoint screenmiddle;
 
         QList<Geometry*> geometries;
+        QHash<Geometry*, qint64> drawOrder; // sorts the geometries found in the index like the list
+        qint64 firstOrder;
+        qint64 lastOrder;
+        QList<Point*> widgetPoints; // not indexed, their widgets are moved on each paint
+        mutable GeometryIndex geometryIndex; // in display coordinates of indexZoom
+        mutable int indexZoom;
+        mutable bool indexValid;
+        mutable QRectF geometriesBox; // in coordinates, see boundingBox()
+        mutable bool geometriesBoxValid;
+        Geometry* borderGeometry; // the last geometry found on the border of the box, see updateBoundingBox()
+        QRectF borderBox;
         MapAdapter* mapAdapter;
         bool takeevents;
         mutable QRect myoffscreenViewport;
 
+        // static geometries drawn once, see GeometryLayer::setStaticGeometryCache()
+        bool cacheStatic;
+        mutable QPixmap staticImage;
+        mutable QRect staticArea; // in display coordinates
+        mutable int staticZoom;
+        mutable QRegion staticDirty; // in display coordinates
+
         ImageManager* m_ImageManager;
 
     signals:
@@ -210,6 +261,16 @@ namespace qmapcontrol
         void updateRequest(QRectF rect);
         void updateRequest();
 
+        //! This signal is emitted when the geometries within an area have changed
+        /*!
+         * @param rect the area in display coordinates
+         */
+        void geometryUpdateRequest(const QRect& rect);
+
+    private slots:
+        void geometryChanged(Geometry* geom);
+        void geometryAreaChanged(QRectF rect);
+
     public slots:
         //! if visible is true, the layer is made visible
         /*!
@@ -24,10 +24,54 @@
 */
 
 #include "layermanager.h"
+#include <QTimer>
+#include <QVector>
+
+// number of scroll steps the prefetch looks ahead
+static const int kPrefetchLookahead = 8;
+// scrolling older than this is not used to predict the next screen
+static const int kPanTimeoutMs = 1000;
+// number of stacks of map layers whose composed tiles are kept, to toggle layers without composing again
+static const int kComposedStacks = 4;
+
+namespace
+{
+    // the parts of a rectangle which are not covered by another one
+    QList<QRect> subtracted(const QRect& rect, const QRect& covered)
+    {
+        QList<QRect> parts;
+        const QRect kept = rect.intersected(covered);
+        if (kept.isEmpty())
+        {
+            parts.append(rect);
+            return parts;
+        }
+
+        if (kept.top() > rect.top())
+        {
+            parts.append(QRect(rect.left(), rect.top(), rect.width(), kept.top() - rect.top()));
+        }
+        if (kept.bottom() < rect.bottom())
+        {
+            parts.append(QRect(rect.left(), kept.bottom() + 1, rect.width(), rect.bottom() - kept.bottom()));
+        }
+        if (kept.left() > rect.left())
+        {
+            parts.append(QRect(rect.left(), kept.top(), kept.left() - rect.left(), kept.height()));
+        }
+        if (kept.right() < rect.right())
+        {
+            parts.append(QRect(kept.right() + 1, kept.top(), rect.right() - kept.right(), kept.height()));
+        }
+        return parts;
+    }
+}
+
 namespace qmapcontrol
 {
     LayerManager::LayerManager(MapControl* mapcontrol, QSize size)
-            :mapcontrol(mapcontrol), scroll(QPoint(0,0)), size(size), whilenewscroll(QPoint(0,0))
+            :mapcontrol(mapcontrol), scroll(QPoint(0,0)), size(size), whilenewscroll(QPoint(0,0)),
+             composedStackVersion(0), prefetchTiles(1), prefetchNeighbourZooms(false)
     {
         // genauer berechnen?
         offSize = size *2;
@@ -98,15 +142,33 @@ namespace qmapcontrol
             zoomImageScroll += point;
             mapmiddle_px += point;
 
+            if (!panTime.isValid() || panTime.elapsed() > kPanTimeoutMs)
+            {
+                panVelocity = point;
+            }
+            else
+            {
+                panVelocity = (panVelocity*3 + point) / 4;
+            }
+            panTime.start();
+
             mapmiddle = tempMiddle;
 
             if (!checkOffscreen())
             {
-                newOffscreenImage();
+                scrollOffscreenImage();
             }
             else
             {
                 moveWidgets();
+
+                // with the velocity known, the tiles ahead are requested before the offscreen image runs out,
+                // but only once the predicted middle moved by a tile
+                const QPoint predicted = mapmiddle_px + predictedScroll();
+                if ((predicted - prefetchedMiddle).manhattanLength() >= layer()->mapadapter()->tilesize())
+                {
+                    prefetch();
+                }
             }
         }
     }
@@ -197,14 +259,17 @@ namespace qmapcontrol
             return;
         }
         
+        // mitte muss in px umgerechnet werden, da aufgrund der projektion die mittebestimmung aus koordinaten ungenau ist
+        const QVector<QPointF> world = coordinates.toVector();
+        QVector<QPoint> points(world.size());
+        layer()->mapadapter()->coordinatesToDisplay(world.constData(), points.data(), world.size());
+
         int sum_x = 0;
         int sum_y = 0;
-        for (int i=0; i<coordinates.size(); ++i)
+        for (int i=0; i<points.size(); ++i)
         {
-            // mitte muss in px umgerechnet werden, da aufgrund der projektion die mittebestimmung aus koordinaten ungenau ist
-            QPoint p = layer()->mapadapter()->coordinateToDisplay(coordinates.at(i));
-            sum_x += p.x();
-            sum_y += p.y();
+            sum_x += points.at(i).x();
+            sum_y += points.at(i).y();
         }
         QPointF middle = layer()->mapadapter()->displayToCoordinate(QPoint(sum_x/coordinates.size(), sum_y/coordinates.size()));
         // middle in px rechnen!
@@ -260,6 +325,8 @@ namespace qmapcontrol
                 this, SLOT(updateRequest(QRectF)));
         connect(layer, SIGNAL(updateRequest()),
                 this, SLOT(updateRequest()));
+        connect(layer, SIGNAL(geometryUpdateRequest(QRect)),
+                this, SLOT(geometryUpdateRequest(QRect)));
 
         if (mylayers.size() > 0)
         {
@@ -300,9 +367,18 @@ namespace qmapcontrol
         }
 
         //only draw basemaps
-        foreach(const Layer* l, mylayers)
+        const QList<Layer*> mapLayers = visibleMapLayers();
+        if (canComposeTiles(mapLayers))
         {
-            if (l->isVisible() && l->layertype() == Layer::MapLayer)
+            foreach(Layer* l, mapLayers)
+            {
+                l->updateViewport(whilenewscroll);
+            }
+            drawComposedTiles(&painter, mapLayers, composedOffscreenImage.rect());
+        }
+        else
+        {
+            foreach(Layer* l, mapLayers)
             {
                 l->drawYourImage(&painter, whilenewscroll);
             }
@@ -311,12 +387,345 @@ namespace qmapcontrol
         //stop the painter now that we've finished drawing
         painter.end();
 
+        prefetch();
+
         //composedOffscreenImage = composedOffscreenImage2;
         scroll = mapmiddle_px-whilenewscroll;
 
         mapcontrol->update();
     }
 
+    void LayerManager::scrollOffscreenImage()
+    {
+        // display area of the offscreen image which holds composed tiles of all map layers
+        QRect kept(whilenewscroll - QPoint(size.width(), size.height()), offSize);
+        const QList<Layer*> mapLayers = visibleMapLayers();
+        foreach(Layer* l, mapLayers)
+        {
+            kept &= l->offscreenViewport();
+        }
+
+        // the composed pixels move along, only the newly exposed tiles are drawn
+        const QPoint delta = mapmiddle_px - whilenewscroll;
+        whilenewscroll = mapmiddle_px;
+        const QPoint origin = whilenewscroll - QPoint(size.width(), size.height());
+        const QRect offscreen(origin, offSize);
+        kept &= offscreen;
+        if (kept.isEmpty() || mapLayers.isEmpty())
+        {
+            newOffscreenImage();
+            return;
+        }
+
+        QRect exposed;
+        foreach(Layer* l, mapLayers)
+        {
+            l->updateViewport(whilenewscroll);
+            exposed |= l->offscreenViewport();
+        }
+        exposed &= offscreen;
+
+        composedOffscreenImage.scroll(-delta.x(), -delta.y(), composedOffscreenImage.rect());
+
+        // same composition as newOffscreenImage(), restricted to the exposed parts
+        QPainter painter(&composedOffscreenImage);
+        foreach(const QRect& part, subtracted(exposed, kept))
+        {
+            const QRect rect = part.translated(-origin);
+            painter.setClipRect(rect);
+            painter.fillRect(rect, Qt::white);
+            painter.drawPixmap(screenmiddle.x()-zoomImageScroll.x(), screenmiddle.y()-zoomImageScroll.y(),zoomImage);
+            drawMapLayers(&painter, mapLayers, rect);
+        }
+        painter.end();
+
+        prefetch();
+
+        scroll = mapmiddle_px-whilenewscroll;
+        moveWidgets();
+        mapcontrol->update();
+    }
+
+    void LayerManager::drawTiles(const QList<TileKey>& tiles)
+    {
+        // area of the received tiles in the offscreen image
+        const QList<Layer*> mapLayers = visibleMapLayers();
+        QRegion dirty;
+        foreach(const TileKey& tile, tiles)
+        {
+            // a tile which was part of composed tiles has changed
+            foreach(const ComposedStack& stack, composedStacks)
+            {
+                if (stack.adapters.contains(tile.adapter))
+                {
+                    composedTiles[stack.version].remove(TileKey(stack.adapters.first(), tile.x, tile.y, tile.z));
+                }
+            }
+
+            foreach(Layer* l, mapLayers)
+            {
+                if (l->mapadapter() == tile.adapter && tile.z == tile.adapter->currentZoom())
+                {
+                    const int tilesize = tile.adapter->tilesize();
+                    const QRect tileRect(tile.x*tilesize, tile.y*tilesize, tilesize, tilesize);
+                    dirty += tileRect.intersected(l->offscreenViewport())
+                                     .translated(QPoint(size.width(), size.height()) - whilenewscroll);
+                    break;
+                }
+            }
+        }
+
+        redrawOffscreenImage(dirty);
+    }
+
+    void LayerManager::redrawOffscreenImage(QRegion dirty)
+    {
+        dirty &= QRegion(composedOffscreenImage.rect());
+        if (dirty.isEmpty())
+        {
+            return;
+        }
+
+        // same composition as newOffscreenImage(), restricted to the dirty region
+        QPainter painter(&composedOffscreenImage);
+        painter.setClipRegion(dirty);
+        painter.fillRect(dirty.boundingRect(), Qt::white);
+        if (mapcontrol->getImageManager()->loadQueueSize() != 0)
+        {
+            painter.drawPixmap(screenmiddle.x()-zoomImageScroll.x(), screenmiddle.y()-zoomImageScroll.y(),zoomImage);
+        }
+
+        drawMapLayers(&painter, visibleMapLayers(), dirty.boundingRect());
+        painter.end();
+
+        // the offscreen image is painted at -scroll-screenmiddle, see drawImage()
+        mapcontrol->update(dirty.translated(-scroll-screenmiddle));
+    }
+
+    QList<Layer*> LayerManager::visibleMapLayers() const
+    {
+        QList<Layer*> mapLayers;
+        QListIterator<Layer*> it(mylayers);
+        while (it.hasNext())
+        {
+            Layer* l = it.next();
+            if (l->isVisible() && l->layertype() == Layer::MapLayer)
+            {
+                mapLayers.append(l);
+            }
+        }
+        return mapLayers;
+    }
+
+    bool LayerManager::canComposeTiles(const QList<Layer*>& mapLayers) const
+    {
+        if (mapLayers.size() < 2)
+        {
+            return false;
+        }
+
+        // the tiles of all layers have to cover the same area, and the geometries of the lower
+        // layers must not be covered, as they are only drawn on top of the composed tiles
+        const int tilesize = mapLayers.first()->mapadapter()->tilesize();
+        for (int i=0; i<mapLayers.size(); ++i)
+        {
+            const Layer* l = mapLayers.at(i);
+            if (!l->hasTiles() || l->mapadapter()->tilesize() != tilesize ||
+                (i < mapLayers.size()-1 && !l->geometries.isEmpty()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TileKey LayerManager::composedTileKey(const QList<Layer*>& mapLayers, int x, int y) const
+    {
+        const MapAdapter* adapter = mapLayers.first()->mapadapter();
+        return TileKey(adapter, x, y, adapter->currentZoom());
+    }
+
+    int LayerManager::composedStack(const QList<Layer*>& mapLayers)
+    {
+        ComposedStack stack;
+        foreach(Layer* l, mapLayers)
+        {
+            stack.adapters.append(l->mapadapter());
+            stack.generations.append(l->mapadapter()->tileGeneration());
+        }
+
+        // the composed tiles stay when layers are hidden and shown again, but not when their server changed
+        QMutableListIterator<ComposedStack> it(composedStacks);
+        while (it.hasNext())
+        {
+            const ComposedStack& known = it.next();
+            if (known.adapters == stack.adapters)
+            {
+                if (known.generations == stack.generations)
+                {
+                    stack.version = known.version;
+                    it.remove();
+                    composedStacks.prepend(stack);
+                    return stack.version;
+                }
+                composedTiles.remove(known.version);
+                it.remove();
+            }
+        }
+
+        foreach(const MapAdapter* adapter, stack.adapters)
+        {
+            if (!composedAdapters.contains(adapter))
+            {
+                // the composed tiles of a destroyed MapAdapter must not be found by a new one at the same address
+                composedAdapters.insert(adapter);
+                connect(adapter, SIGNAL(destroyed(QObject*)), this, SLOT(composedAdapterDestroyed(QObject*)));
+            }
+        }
+
+        stack.version = ++composedStackVersion;
+        composedStacks.prepend(stack);
+        while (composedStacks.size() > kComposedStacks)
+        {
+            composedTiles.remove(composedStacks.takeLast().version);
+        }
+        return stack.version;
+    }
+
+    void LayerManager::composedAdapterDestroyed(QObject* adapter)
+    {
+        composedAdapters.remove(adapter);
+
+        QMutableListIterator<ComposedStack> it(composedStacks);
+        while (it.hasNext())
+        {
+            const ComposedStack& stack = it.next();
+            foreach(const MapAdapter* a, stack.adapters)
+            {
+                if (static_cast<const QObject*>(a) == adapter)
+                {
+                    composedTiles.remove(stack.version);
+                    it.remove();
+                    break;
+                }
+            }
+        }
+    }
+
+    void LayerManager::drawMapLayers(QPainter* painter, const QList<Layer*>& mapLayers, const QRect& rect)
+    {
+        if (canComposeTiles(mapLayers))
+        {
+            drawComposedTiles(painter, mapLayers, rect);
+            return;
+        }
+
+        foreach(Layer* l, mapLayers)
+        {
+            l->drawTiles(painter, whilenewscroll, rect);
+        }
+    }
+
+    void LayerManager::drawComposedTiles(QPainter* painter, const QList<Layer*>& mapLayers, const QRect& rect)
+    {
+        QHash<TileKey, QPixmap>& tiles = composedTiles[composedStack(mapLayers)];
+
+        // the offscreen image starts one screen left and above of the middle
+        const QPoint origin = whilenewscroll - QPoint(size.width(), size.height());
+        const QRect viewport = mapLayers.first()->offscreenViewport();
+        const QRect area = rect.translated(origin).intersected(viewport);
+        if (area.isEmpty())
+        {
+            return;
+        }
+
+        const int tilesize = mapLayers.first()->mapadapter()->tilesize();
+        for (int i=tileIndex(area.left(), tilesize); i<=tileIndex(area.right(), tilesize); ++i)
+        {
+            for (int j=tileIndex(area.top(), tilesize); j<=tileIndex(area.bottom(), tilesize); ++j)
+            {
+                const TileKey key = composedTileKey(mapLayers, i, j);
+                QPixmap composed = tiles.value(key);
+                if (composed.isNull())
+                {
+                    composed = QPixmap(tilesize, tilesize);
+                    composed.fill(Qt::transparent);
+                    QPainter tilePainter(&composed);
+                    bool complete = true;
+                    foreach(Layer* l, mapLayers)
+                    {
+                        complete &= l->drawTile(&tilePainter, QPoint(0,0), i, j);
+                    }
+                    tilePainter.end();
+
+                    // tiles with placeholders are composed again when the missing tiles arrive
+                    if (complete)
+                    {
+                        tiles.insert(key, composed);
+                    }
+                }
+                painter->drawPixmap(QPoint(i*tilesize, j*tilesize) - origin, composed);
+            }
+        }
+
+        foreach(Layer* l, mapLayers)
+        {
+            l->drawYourGeometries(painter, whilenewscroll - screenmiddle, l->offscreenViewport());
+        }
+
+        // only the tiles around the offscreen image are kept
+        const int maxTiles = 2 * (viewport.width()/tilesize + 1) * (viewport.height()/tilesize + 1);
+        if (tiles.size() > maxTiles)
+        {
+            const QRect kept = viewport.adjusted(-viewport.width()/2, -viewport.height()/2,
+                                                 viewport.width()/2, viewport.height()/2);
+            QMutableHashIterator<TileKey, QPixmap> it(tiles);
+            while (it.hasNext())
+            {
+                const TileKey& tile = it.next().key();
+                if (tile != composedTileKey(mapLayers, tile.x, tile.y) ||
+                    !kept.contains(QPoint(tile.x*tilesize + tilesize/2, tile.y*tilesize + tilesize/2)))
+                {
+                    it.remove();
+                }
+            }
+        }
+    }
+
+    void LayerManager::prefetch()
+    {
+        // prefetching starts when all visible tiles are loaded
+        if (mapcontrol->getImageManager()->loadQueueSize() != 0)
+        {
+            return;
+        }
+
+        const QPoint predicted = mapmiddle_px + predictedScroll();
+        prefetchedMiddle = predicted;
+        QListIterator<Layer*> it(mylayers);
+        while (it.hasNext())
+        {
+            Layer* l = it.next();
+            if (l->isVisible() && l->layertype() == Layer::MapLayer)
+            {
+                l->prefetchTiles(mapmiddle_px, predicted, prefetchTiles, prefetchNeighbourZooms);
+            }
+        }
+    }
+
+    QPoint LayerManager::predictedScroll() const
+    {
+        if (!panTime.isValid() || panTime.elapsed() > kPanTimeoutMs)
+        {
+            return QPoint(0,0);
+        }
+
+        // never look further ahead than one screen
+        const QPoint ahead = panVelocity * kPrefetchLookahead;
+        return QPoint(qBound(-size.width(), ahead.x(), size.width()),
+                      qBound(-size.height(), ahead.y(), size.height()));
+    }
+
     void LayerManager::zoomIn()
     {
         if ( !layer() )
@@ -325,11 +734,12 @@ namespace qmapcontrol
             return;
         }
 
-        mapcontrol->getImageManager()->abortLoading();
         //QCoreApplication::processEvents();
 
         // layer rendern abbrechen?
+        // tiles of the previous zoom level are cancelled by the ImageManager when the new offscreen image is drawn
         zoomImageScroll = QPoint(0,0);
+        panVelocity = QPoint(0,0);
 
         zoomImage.fill(Qt::white);
         QPixmap tmpImg = composedOffscreenImage.copy(screenmiddle.x()+scroll.x(),screenmiddle.y()+scroll.y(), size.width(), size.height());
@@ -390,8 +800,8 @@ namespace qmapcontrol
         }
 
         //QCoreApplication::processEvents();
-        mapcontrol->getImageManager()->abortLoading();
         zoomImageScroll = QPoint(0,0);
+        panVelocity = QPoint(0,0);
         zoomImage.fill(Qt::white);
         QPixmap tmpImg = composedOffscreenImage.copy(screenmiddle.x()+scroll.x(),screenmiddle.y()+scroll.y(), size.width(), size.height());
         QPainter painter(&zoomImage);
@@ -487,6 +897,38 @@ namespace qmapcontrol
             newOffscreenImage(false, false);
         }
     }
+    void LayerManager::geometryUpdateRequest(const QRect& rect)
+    {
+        const Layer* l = qobject_cast<const Layer*>(sender());
+        if (!l || !l->isVisible())
+        {
+            return;
+        }
+
+        if (l->layertype() == Layer::MapLayer)
+        {
+            // the geometries of map layers are part of the offscreen image, which is composed again once the
+            // change is done: geometries announce it before they change, too, and would be drawn at their old place
+            if (pendingGeometries.isEmpty())
+            {
+                QTimer::singleShot(0, this, SLOT(flushGeometryUpdates()));
+            }
+            pendingGeometries += rect;
+        }
+        else
+        {
+            // geometry layers are drawn on each paint, only the area on the screen has to be painted again
+            mapcontrol->update(rect.translated(screenmiddle - mapmiddle_px));
+        }
+    }
+
+    void LayerManager::flushGeometryUpdates()
+    {
+        const QRegion dirty = pendingGeometries.translated(QPoint(size.width(), size.height()) - whilenewscroll);
+        pendingGeometries = QRegion();
+        redrawOffscreenImage(dirty);
+    }
+
     void LayerManager::updateRequest()
     {
         newOffscreenImage(true, false);
@@ -495,26 +937,52 @@ namespace qmapcontrol
     {
         newOffscreenImage(true, false);
     }
+
+    void LayerManager::invalidateStaticGeometries()
+    {
+        foreach(Layer* l, mylayers)
+        {
+            if (l->layertype() == Layer::GeometryLayer)
+            {
+                l->invalidateStaticGeometries();
+            }
+        }
+    }
     void LayerManager::removeZoomImage()
     {
         zoomImage.fill(Qt::white);
         forceRedraw();
     }
 
-    void LayerManager::drawGeoms(QPainter* painter)
+    void LayerManager::drawGeoms(QPainter* painter, const QRect& rect)
     {
         if ( !layer() )
         {
             qDebug() << "LayerManager::drawGeoms() - no layers configured";
             return;
         }
+
+        // geometries outside of the painted area are skipped
+        const QRect viewport = layer()->offscreenViewport().intersected(rect.translated(mapmiddle_px - screenmiddle));
+        if (viewport.isEmpty())
+        {
+            return;
+        }
+
         QListIterator<Layer*> it(mylayers);
         while (it.hasNext())
         {
             Layer* l = it.next();
             if (l->layertype() == Layer::GeometryLayer && l->isVisible())
             {
-                l->drawYourGeometries(painter, mapmiddle_px, layer()->offscreenViewport());
+                if (l->cacheStatic)
+                {
+                    l->drawCachedGeometries(painter, mapmiddle_px, layer()->offscreenViewport(), viewport);
+                }
+                else
+                {
+                    l->drawYourGeometries(painter, mapmiddle_px, viewport);
+                }
             }
         }
     }
@@ -599,4 +1067,24 @@ namespace qmapcontrol
     {
         return boundingBox;
     }
+
+    void LayerManager::setPrefetchRing(int tiles)
+    {
+        prefetchTiles = qMax(0, tiles);
+    }
+
+    int LayerManager::prefetchRing() const
+    {
+        return prefetchTiles;
+    }
+
+    void LayerManager::setPrefetchZoomLevels(bool enabled)
+    {
+        prefetchNeighbourZooms = enabled;
+    }
+
+    bool LayerManager::prefetchZoomLevels() const
+    {
+        return prefetchNeighbourZooms;
+    }
 }
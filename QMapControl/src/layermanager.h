@@ -31,9 +31,13 @@
 #include <QMap>
 #include <QListIterator>
 #include <QRectF>
+#include <QElapsedTimer>
+#include <QRegion>
+#include <QSet>
 #include "layer.h"
 #include "mapadapter.h"
 #include "mapcontrol.h"
+#include "tilekey.h"
 
 namespace qmapcontrol
 {
@@ -161,6 +165,20 @@ namespace qmapcontrol
         void forceRedraw();
         void removeZoomImage();
 
+        //! drops the cached static geometries of all geometry layers
+        /*!
+         * They are drawn again at the next paint, with changes which the geometries did not announce.
+         */
+        void invalidateStaticGeometries();
+
+        //! redraws the given tiles in the offscreen image
+        /*!
+         * Only the area of the tiles is composed again, all map layers are drawn there in their order.
+         * Tiles which are not part of the offscreen image are ignored.
+         * @param tiles the tiles which were received
+         */
+        void drawTiles(const QList<TileKey>& tiles);
+
         //! adds a layer
         /*!
          * If multiple layers are added, they are painted in the added order.
@@ -181,7 +199,12 @@ namespace qmapcontrol
          */
         int currentZoom() const;
 
-        void drawGeoms(QPainter* painter);
+        //! draws the geometry layers
+        /*!
+         * @param painter the painter of the widget
+         * @param rect the area of the widget which is painted, geometries outside are not drawn
+         */
+        void drawGeoms(QPainter* painter, const QRect& rect);
         void drawImage(QPainter* painter);
 
 
@@ -213,6 +236,26 @@ namespace qmapcontrol
          */
         QRectF getBoundingBox();
 
+        //! Sets how many tiles around the screen are loaded in advance
+        /*!
+         * The ring is placed around the current screen and the screen the map is expected to be panned to.
+         * The expected screen follows the direction and speed of the recent scrolling.
+         * @param tiles the width of the ring in tiles, 0 disables prefetching
+         */
+        void setPrefetchRing(int tiles);
+
+        //! returns the width of the prefetch ring in tiles
+        int prefetchRing() const;
+
+        //! Sets whether the zoom levels above and below the current one are loaded in advance
+        /*!
+         * @param enabled true if the tiles of the neighbour zoom levels should be prefetched
+         */
+        void setPrefetchZoomLevels(bool enabled);
+
+        //! returns if the neighbour zoom levels are prefetched
+        bool prefetchZoomLevels() const;
+
     private:
         LayerManager& operator=(const LayerManager& rhs);
         LayerManager(const LayerManager& old);
@@ -222,10 +265,24 @@ namespace qmapcontrol
          * @param showZoomImage if a zoom image should be painted
          */
         void newOffscreenImage(bool clearImage=true, bool showZoomImage=true);
+        //! moves the offscreen image to the current map middle and only draws the exposed tiles
+        void scrollOffscreenImage();
+        QList<Layer*> visibleMapLayers() const;
+        bool canComposeTiles(const QList<Layer*>& mapLayers) const;
+        TileKey composedTileKey(const QList<Layer*>& mapLayers, int x, int y) const;
+        //! returns the version of the stack of map layers, which keys its composed tiles
+        int composedStack(const QList<Layer*>& mapLayers);
+        void drawMapLayers(QPainter* painter, const QList<Layer*>& mapLayers, const QRect& rect);
+        //! draws the tiles of all map layers from tiles which are composed once
+        void drawComposedTiles(QPainter* painter, const QList<Layer*>& mapLayers, const QRect& rect);
+        //! composes the dirty region of the offscreen image again and updates it on the screen
+        void redrawOffscreenImage(QRegion dirty);
         inline bool checkOffscreen() const;
         inline bool containsAll(QList<QPointF> coordinates) const;
         inline void moveWidgets();
         inline void setMiddle(QList<QPointF> coordinates);
+        void prefetch();
+        QPoint predictedScroll() const;
 
         MapControl* mapcontrol;
         QPoint screenmiddle; // middle of the screen
@@ -238,6 +295,21 @@ namespace qmapcontrol
         QPixmap composedOffscreenImage;
         QPixmap zoomImage;
 
+        // a stack of visible map layers whose tiles were composed
+        struct ComposedStack
+        {
+            QList<const MapAdapter*> adapters;
+            QList<int> generations; // MapAdapter::tileGeneration() of the adapters
+            int version;
+        };
+
+        // the tiles of all visible map layers blended into one, by the version of their stack and
+        // the tile of the lowest layer
+        QHash<int, QHash<TileKey, QPixmap> > composedTiles;
+        QList<ComposedStack> composedStacks; // the most recently drawn first
+        int composedStackVersion; // the version of the last new stack
+        QSet<const QObject*> composedAdapters; // MapAdapters whose destruction is watched
+
         QList<Layer*>	mylayers;
 
         QPoint mapmiddle_px; // projection-display coordinates
@@ -245,13 +317,27 @@ namespace qmapcontrol
 
         QPoint whilenewscroll;
 
+        // areas of changed geometries on map layers, in display coordinates, see flushGeometryUpdates()
+        QRegion pendingGeometries;
+
         QRectF boundingBox; // limit viewing area if desired
         bool useBoundingBox;
 
+        QPoint panVelocity; // smoothed scroll distance per scroll step
+        QElapsedTimer panTime; // time of the last scroll step
+        QPoint prefetchedMiddle; // the predicted map middle of the last prefetch
+        int prefetchTiles;
+        bool prefetchNeighbourZooms;
+
     public slots:
         void updateRequest(QRectF rect);
         void updateRequest();
         void resize(QSize newSize);
+
+    private slots:
+        void geometryUpdateRequest(const QRect& rect);
+        void flushGeometryUpdates();
+        void composedAdapterDestroyed(QObject* adapter);
     };
 }
 #endif
@@ -24,16 +24,34 @@
 */
 
 #include "linestring.h"
+#include <typeinfo>
+
+namespace
+{
+    // the top left of a bounding box is the minimum and the bottom right the maximum coordinate
+    QRectF extendBox(const QRectF& box, const QPointF& coordinate)
+    {
+        return QRectF(QPointF(qMin(box.left(), coordinate.x()), qMin(box.top(), coordinate.y())),
+                      QPointF(qMax(box.right(), coordinate.x()), qMax(box.bottom(), coordinate.y())));
+    }
+
+    bool onBorder(const QRectF& box, const QPointF& coordinate)
+    {
+        return coordinate.x() == box.left() || coordinate.x() == box.right()
+            || coordinate.y() == box.top() || coordinate.y() == box.bottom();
+    }
+}
+
 namespace qmapcontrol
 {
     LineString::LineString()
-            : Curve()
+            : Curve(), boxValid(false), borderPoint(0), boxAdapter(0), boxZoom(0), pointWidgets(false), lodAdapter(0)
     {
         GeometryType = "LineString";
     }
 
     LineString::LineString(QList<Point*> const points, QString name, QPen* pen)
-            :Curve(name)
+            :Curve(name), boxValid(false), borderPoint(0), boxAdapter(0), boxZoom(0), pointWidgets(false), lodAdapter(0)
     {
         mypen = pen;
         LineString();
@@ -56,14 +74,59 @@ namespace qmapcontrol
                 delete pt;
                 pt = 0;
             }
+            else if (pt)
+            {
+                disconnect(pt, 0, this, 0);
+            }
         }
         childPoints.clear();
+        boxValid = false;
+        borderPoint = 0;
+        resetCache();
     }
 
     void LineString::addPoint(Point* point)
     {
         point->setParentGeometry(this);
         childPoints.append(point);
+        connect(point, SIGNAL(updateRequest(Geometry*)),
+                this, SLOT(pointChanged(Geometry*)));
+        if (boxValid)
+        {
+            box = extendBox(box, point->coordinate());
+        }
+        resetCache();
+        // the line only grows, so its new area covers the old one
+        emit(updateRequest(this));
+    }
+
+    void LineString::pointChanged(Geometry* geom)
+    {
+        // points announce a move before and after it: a point which has left the border
+        // may shrink the box, at its new place a point can only extend it
+        Point* point = static_cast<Point*>(geom);
+        const QPointF coordinate = point->coordinate();
+        if (point == borderPoint && coordinate != borderCoordinate)
+        {
+            boxValid = false;
+            borderPoint = 0;
+        }
+
+        // the box is built before the change is announced, the layer asks for it right away
+        boundingBox();
+        if (onBorder(box, coordinate))
+        {
+            borderPoint = point;
+            borderCoordinate = coordinate;
+        }
+        else
+        {
+            box = extendBox(box, coordinate);
+        }
+
+        // a moved point or a new pixmap changes the area of the line
+        resetCache();
+        emit(updateRequest(this));
     }
 
     QList<Point*> LineString::points()
@@ -73,13 +136,18 @@ namespace qmapcontrol
 
     void LineString::setPoints(QList<Point*> points)
     {
+        emit(updateRequest(this));
         removePoints();
 
         for (int i=0; i<points.size(); i++)
         {
             points.at(i)->setParentGeometry(this);
+            connect(points.at(i), SIGNAL(updateRequest(Geometry*)),
+                    this, SLOT(pointChanged(Geometry*)));
         }
         childPoints = points;
+        resetCache();
+        emit(updateRequest(this));
     }
 
     void LineString::draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &screensize, const QPoint offset)
@@ -87,28 +155,158 @@ namespace qmapcontrol
         if (!visible)
             return;
 
-        QPolygon p = QPolygon();
+        // whole lines and points outside of the viewport are skipped by their cached area
+        updateDisplayBox(mapadapter);
+        const int margin = penMargin();
+        const QRectF clip = screensize.adjusted(-margin, -margin, margin, margin);
 
-        QPointF c;
-        for (int i=0; i<childPoints.size(); i++)
+        if (clip.intersects(lineBox))
         {
-            c = childPoints[i]->coordinate();
-            p.append(mapadapter->coordinateToDisplay(c));
+            if (mypen != 0)
+            {
+                painter->save();
+                painter->setPen(*mypen);
+            }
+
+            projectPoints(mapadapter);
+
+            // long lines are drawn with the points which are visible at this zoom
+            const QVector<int> lod = levelOfDetail(mapadapter);
+            const int count = lod.isEmpty() ? childPoints.size() : lod.size();
+
+            // only the segments within the viewport are drawn
+            QVector<QPointF> line(count);
+            for (int i=0; i<count; i++)
+            {
+                line[i] = childPoints.at(lod.isEmpty() ? i : lod.at(i))->displayPositionF(mapadapter);
+            }
+            drawClipped(painter, clip, line);
+
+            if (mypen != 0)
+            {
+                painter->restore();
+            }
         }
-        if (mypen != 0)
+
+        // plain points without pixmap or widget don't draw anything
+        const bool pixmaps = screensize.intersects(pointsBox);
+        if (pixmaps || pointWidgets)
         {
-            painter->save();
-            painter->setPen(*mypen);
+            for (int i=0; i<childPoints.size(); i++)
+            {
+                Point* point = childPoints.at(i);
+                if ((pixmaps && drawsOnMap(point)) || point->mywidget != 0)
+                {
+                    point->draw(painter, mapadapter, screensize, offset);
+                }
+            }
         }
-        painter->drawPolyline(p);
-        if (mypen != 0)
+    }
+
+    QVector<int> LineString::levelOfDetail(const MapAdapter* mapadapter)
+    {
+        if (lodAdapter != mapadapter)
         {
-            painter->restore();
+            lods.clear();
+            lodAdapter = mapadapter;
         }
-        for (int i=0; i<childPoints.size(); i++)
+
+        const int zoom = mapadapter->currentZoom();
+        QHash<int, QVector<int> >::const_iterator it = lods.constFind(zoom);
+        if (it != lods.constEnd())
         {
-            childPoints[i]->draw(painter, mapadapter, screensize, offset);
+            return it.value();
         }
+
+        QVector<QPointF> projected(childPoints.size());
+        for (int i=0; i<childPoints.size(); ++i)
+        {
+            projected[i] = childPoints.at(i)->displayPositionF(mapadapter);
+        }
+        const QVector<int> lod = simplify(projected);
+        lods.insert(zoom, lod);
+        return lod;
+    }
+
+    void LineString::projectPoints(const MapAdapter* mapadapter)
+    {
+        // the points with an outdated display coordinate are projected together
+        const int zoom = mapadapter->currentZoom();
+        QVector<int> outdated;
+        for (int i=0; i<childPoints.size(); ++i)
+        {
+            const Point* point = childPoints.at(i);
+            if (point->projectedAdapter != mapadapter || point->projectedZoom != zoom)
+            {
+                outdated.append(i);
+            }
+        }
+        if (outdated.isEmpty())
+        {
+            return;
+        }
+
+        QVector<QPointF> coordinates(outdated.size());
+        for (int i=0; i<outdated.size(); ++i)
+        {
+            coordinates[i] = childPoints.at(outdated.at(i))->coordinate();
+        }
+        QVector<QPointF> projected(outdated.size());
+        mapadapter->coordinatesToDisplayF(coordinates.constData(), projected.data(), outdated.size());
+
+        for (int i=0; i<outdated.size(); ++i)
+        {
+            Point* point = childPoints.at(outdated.at(i));
+            point->projected = projected.at(i);
+            point->projectedAdapter = mapadapter;
+            point->projectedZoom = zoom;
+        }
+    }
+
+    void LineString::resetCache()
+    {
+        boxAdapter = 0;
+        lods.clear();
+    }
+
+    void LineString::updateDisplayBox(const MapAdapter* mapadapter)
+    {
+        const int zoom = mapadapter->currentZoom();
+        if (boxAdapter == mapadapter && boxZoom == zoom)
+        {
+            return;
+        }
+
+        lineBox = QRect();
+        if (!childPoints.isEmpty())
+        {
+            // the projection keeps the order of the coordinates, so the corners are sufficient
+            const QRectF box = boundingBox();
+            // the line is drawn with the fractions of the pixels, which reach into the next one
+            lineBox = QRect(mapadapter->coordinateToDisplay(box.topLeft()),
+                            mapadapter->coordinateToDisplay(box.bottomRight())).normalized().adjusted(0, 0, 1, 1);
+        }
+
+        pointsBox = QRect();
+        pointWidgets = false;
+        for (int i=0; i<childPoints.size(); ++i)
+        {
+            Point* point = childPoints.at(i);
+            if (drawsOnMap(point))
+            {
+                pointsBox |= point->displayBoundingBox(mapadapter);
+            }
+            pointWidgets = pointWidgets || point->mywidget != 0;
+        }
+
+        boxAdapter = mapadapter;
+        boxZoom = zoom;
+    }
+
+    bool LineString::drawsOnMap(const Point* point)
+    {
+        // subclasses like CirclePoint may draw without a pixmap
+        return point->mypixmap.width() > 0 || typeid(*point) != typeid(Point);
     }
 
     int LineString::numberOfPoints() const
@@ -129,6 +327,7 @@ namespace qmapcontrol
         bool touches = false;
 
         QPointF clickPt = mapadapter->coordinateToDisplay(geom->coordinate());
+        projectPoints(mapadapter);
 
         qreal halfwidth = 2; // use 2 pixels by default
         if (mypen && mypen->width() > 0)
@@ -136,14 +335,14 @@ namespace qmapcontrol
             halfwidth = static_cast<qreal> (mypen->width())/ static_cast<qreal> (2);
         }
 
-        QPointF pt1 = mapadapter->coordinateToDisplay(points().at(0)->coordinate());
+        QPointF pt1 = childPoints.at(0)->displayPositionF(mapadapter);
         qreal pt1x1 = pt1.x() - halfwidth;
         qreal pt1x2 = pt1.x() + halfwidth;
         qreal pt1y1 = pt1.y() - halfwidth;
         qreal pt1y2 = pt1.y() + halfwidth;
         for (int i = 1; i < childPoints.size(); ++i)
         {
-            QPointF pt2 = mapadapter->coordinateToDisplay(childPoints.at(i)->coordinate());
+            QPointF pt2 = childPoints.at(i)->displayPositionF(mapadapter);
             qreal pt2x1 = pt2.x() - halfwidth;
             qreal pt2x2 = pt2.x() + halfwidth;
             qreal pt2y1 = pt2.y() - halfwidth;
@@ -202,6 +401,11 @@ namespace qmapcontrol
 
     QRectF LineString::boundingBox()
     {
+        if (boxValid)
+        {
+            return box;
+        }
+
         qreal minlon=180;
         qreal maxlon=-180;
         qreal minlat=90;
@@ -219,6 +423,21 @@ namespace qmapcontrol
         QPointF dist = max - min;
         QSizeF si = QSizeF(dist.x(), dist.y());
 
-        return QRectF(min, si);
+        box = QRectF(min, si);
+        boxValid = true;
+        return box;
+    }
+
+    QRect LineString::displayBoundingBox(const MapAdapter* mapadapter)
+    {
+        updateDisplayBox(mapadapter);
+        if (lineBox.isNull())
+        {
+            return pointsBox;
+        }
+
+        // the pixmaps of the points may reach beyond the line
+        const int margin = penMargin();
+        return lineBox.adjusted(-margin, -margin, margin, margin) | pointsBox;
     }
 }
@@ -28,12 +28,16 @@
 
 #include "qmapcontrol_global.h"
 #include "curve.h"
+#include <QHash>
+#include <QVector>
 
 namespace qmapcontrol
 {
     //! A collection of Point objects to describe a line
     /*!
      * A LineString is a Curve with linear interpolation between Points. Each consecutive pair of Points defines a Line segment.
+     * Long lines are drawn with fewer points at low zoom levels, leaving out the ones which would not change
+     * the line by more than a pixel. The simplified lines are built once for each zoom level.
      *	@author Kai Winter <kaiwinter@gmx.de>
      */
     class QMAPCONTROL_EXPORT LineString : public Curve
@@ -80,9 +84,12 @@ namespace qmapcontrol
 
         //! returns the bounding box (rect) that contains all points
         /*!
+         * The box is cached and follows the added and moved points, it is only
+         * computed again after a point on its border has moved.
          * @return the rect that contains all points
          */
         virtual QRectF boundingBox();
+        virtual QRect displayBoundingBox(const MapAdapter* mapadapter);
 
         //! returns true if the LineString has Childs
         /*!
@@ -114,14 +121,39 @@ namespace qmapcontrol
         virtual bool Touches ( Point* geom, const MapAdapter* mapadapter );
         virtual void draw ( QPainter* painter, const MapAdapter* mapadapter, const QRect &screensize, const QPoint offset );
 
+    private slots:
+        void pointChanged(Geometry* geom);
+
     private:
         //! removes cleans up memory of child points that were reparented with setPoints()
         /*!
          * @see setPoints()
          */
         void removePoints();
+        void updateDisplayBox(const MapAdapter* mapadapter);
+        static bool drawsOnMap(const Point* point);
+        QVector<int> levelOfDetail(const MapAdapter* mapadapter);
+        void projectPoints(const MapAdapter* mapadapter);
+        void resetCache();
 
         QList<Point*>	childPoints;
+
+        // the bounding box, extended while points are added or moved and only rebuilt when it may shrink
+        QRectF box;
+        bool boxValid;
+        Point* borderPoint; // the last point found on the border of the box, see pointChanged()
+        QPointF borderCoordinate;
+
+        // the area of the line and of the pixmaps of its points, in display coordinates of boxZoom
+        const MapAdapter* boxAdapter;
+        int boxZoom;
+        QRect lineBox;
+        QRect pointsBox;
+        bool pointWidgets;
+
+        // the points which are drawn at a zoom level, built on first use
+        const MapAdapter* lodAdapter;
+        QHash<int, QVector<int> > lods;
     };
 }
 #endif
@@ -27,7 +27,7 @@
 namespace qmapcontrol
 {
     MapAdapter::MapAdapter(const QString& qHost, const QString& qServerPath, int qTilesize, int qMinZoom, int qMaxZoom)
-            :mTileSize(qTilesize), mMin_zoom(qMinZoom), mMax_zoom(qMaxZoom)
+            :mTileGeneration(0), mTileSize(qTilesize), mMin_zoom(qMinZoom), mMax_zoom(qMaxZoom)
     {
         mCurrent_zoom = qMinZoom;
         changeHostAddress( qHost, qServerPath );
@@ -41,6 +41,40 @@ namespace qmapcontrol
     {
         mServerHost = qHost;
         mServerPath = qServerPath;
+        mServerHosts.clear();
+        ++mTileGeneration;
+    }
+
+    void MapAdapter::setHosts( const QStringList& qHosts )
+    {
+        mServerHosts = qHosts;
+        if ( !qHosts.isEmpty() )
+        {
+            mServerHost = qHosts.first();
+        }
+        ++mTileGeneration;
+    }
+
+    int MapAdapter::tileGeneration() const
+    {
+        return mTileGeneration;
+    }
+
+    QStringList MapAdapter::hosts() const
+    {
+        return mServerHosts.isEmpty() ? QStringList(mServerHost) : mServerHosts;
+    }
+
+    QString MapAdapter::tileHost( int x, int y, int z ) const
+    {
+        Q_UNUSED(z);
+        if ( mServerHosts.size() < 2 )
+        {
+            return mServerHost;
+        }
+
+        // neighbouring tiles differ in x+y, so the tiles of one screen are spread evenly
+        return mServerHosts.at( qAbs(x + y) % mServerHosts.size() );
     }
 
     QString MapAdapter::host() const
@@ -78,11 +112,53 @@ namespace qmapcontrol
         return mMax_zoom < mMin_zoom ? mMin_zoom - mCurrent_zoom : mCurrent_zoom;
     }
 
+    QPointF MapAdapter::coordinateToDisplayF(const QPointF& coordinate) const
+    {
+        return coordinateToDisplay(coordinate);
+    }
+
+    void MapAdapter::coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const
+    {
+        for (int i=0; i<count; ++i)
+        {
+            points[i] = coordinateToDisplayF(coordinates[i]);
+        }
+    }
+
+    void MapAdapter::coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const
+    {
+        for (int i=0; i<count; ++i)
+        {
+            points[i] = coordinateToDisplay(coordinates[i]);
+        }
+    }
+
+    void MapAdapter::displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const
+    {
+        for (int i=0; i<count; ++i)
+        {
+            coordinates[i] = displayToCoordinate(points[i]);
+        }
+    }
+
     void MapAdapter::setBoundingBox(qreal qMinX, qreal qMinY, qreal qMaxX, qreal qMaxY )
     {
         mBoundingBox = QRectF( QPointF( qMinX, qMinY ), QPointF(qMaxX, qMaxY ) ); 
     }
 
+    bool MapAdapter::hasLocalTiles() const
+    {
+        return false;
+    }
+
+    QByteArray MapAdapter::tileData(int x, int y, int z) const
+    {
+        Q_UNUSED(x);
+        Q_UNUSED(y);
+        Q_UNUSED(z);
+        return QByteArray();
+    }
+
     int MapAdapter::tileSize()
     {
         return mTileSize;
@@ -33,6 +33,8 @@
 #include <QPointF>
 #include <QRectF>
 #include <QLocale>
+#include <QStringList>
+#include <QByteArray>
 #include <QDebug>
 #include <cmath>
 
@@ -56,6 +58,8 @@ namespace qmapcontrol
     class QMAPCONTROL_EXPORT MapAdapter : public QObject
     {
         friend class Layer;
+        friend class ImageManager;
+        friend class TileSeeder;
 
         Q_OBJECT
 
@@ -76,11 +80,48 @@ namespace qmapcontrol
 
         //! change or update server host address post init
         /*!
+         * The host may contain a scheme and a port, e.g. "https://tile.example.org" or "tile.example.org:8080".
+         * Without a scheme the tiles are loaded with HTTP.
          * @param host the host address
          * @param serverPath the server path
          */
         virtual void changeHostAddress( const QString qHost, const QString qServerPath = QString() );
 
+        //! sets a pool of hosts which serve the same tiles
+        /*!
+         * Many tile servers offer the same tiles from several hosts, e.g. a.tile.example.org, b.tile.example.org, ...
+         * The tiles are spread over these hosts by tileHost(), so more tiles can be loaded in parallel.
+         * The first host becomes the host() of the MapAdapter. Calling changeHostAddress() clears the pool.
+         * @param qHosts the host addresses, optionally with scheme and port ("https://host:port")
+         */
+        void setHosts( const QStringList& qHosts );
+
+        //! returns the hosts the tiles are loaded from
+        /*!
+         * @return the host pool, or only host() if no pool is set
+         */
+        QStringList hosts() const;
+
+        //! returns the host a tile is loaded from
+        /*!
+         * The default implementation spreads neighbouring tiles over the hosts of the pool.
+         * A tile is always loaded from the same host, so caches of the servers and proxies are used.
+         * Reimplement this to use another sharding.
+         * @param x the x value of the tile
+         * @param y the y value of the tile
+         * @param z the zoom value of the tile
+         * @return the host of the tile
+         */
+        virtual QString tileHost( int x, int y, int z ) const;
+
+        //! returns the generation of the tiles
+        /*!
+         * The generation is counted up by changeHostAddress() and setHosts(), so tiles of the
+         * previous server are no longer found in the caches, which key them by TileKey.
+         * @return the generation of the tiles
+         */
+        int tileGeneration() const;
+
         //! returns the size of the tiles
         /*!
          * @return the size of the tiles
@@ -116,6 +157,16 @@ namespace qmapcontrol
          */
         virtual QPoint coordinateToDisplay(const QPointF& coordinate) const = 0;
 
+        //! translates a world coordinate to display coordinate with sub-pixel precision
+        /*!
+         * coordinateToDisplay() cuts off the fraction of the pixel, which is needed for tiles.
+         * Geometries use this to draw lines and images without rounding errors. The default implementation
+         * returns the result of coordinateToDisplay(), subclasses which project on their own reimplement it.
+         * @param  coordinate the world coordinate
+         * @return the display coordinate, its integer part equals coordinateToDisplay()
+         */
+        virtual QPointF coordinateToDisplayF(const QPointF& coordinate) const;
+
         //! translates display coordinate to world coordinate
         /*!
          * The calculations also needs the current zoom. The current zoom is managed by the MapAdapter, so this is no problem.
@@ -125,6 +176,36 @@ namespace qmapcontrol
          */
         virtual QPointF displayToCoordinate(const QPoint& point) const = 0;
 
+        //! translates many world coordinates to display coordinates
+        /*!
+         * This gives the same results as coordinateToDisplay() for each coordinate, but runs without a virtual
+         * call per coordinate and computes the factors of the zoom level only once. It is used for long lines.
+         * TileMapAdapter and WMSMapAdapter use their own projection only for subclasses which call
+         * setProjectionInherited(), otherwise they call coordinateToDisplay() for each coordinate.
+         * @param coordinates the world coordinates
+         * @param points receives the display coordinates, it must have room for count points
+         * @param count the number of coordinates
+         */
+        virtual void coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const;
+
+        //! translates many world coordinates to display coordinates with sub-pixel precision
+        /*!
+         * This gives the same results as coordinateToDisplayF() for each coordinate, see coordinatesToDisplay().
+         * @param coordinates the world coordinates
+         * @param points receives the display coordinates, it must have room for count points
+         * @param count the number of coordinates
+         */
+        virtual void coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const;
+
+        //! translates many display coordinates to world coordinates
+        /*!
+         * This gives the same results as displayToCoordinate() for each point, see coordinatesToDisplay().
+         * @param points the display coordinates
+         * @param coordinates receives the world coordinates, it must have room for count coordinates
+         * @param count the number of points
+         */
+        virtual void displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const;
+
         QRectF getBoundingbox() const { return mBoundingBox; }
         void setBoundingBox(qreal qMinX, qreal qMinY, qreal qMaxX, qreal qMaxY );
 
@@ -142,9 +223,21 @@ namespace qmapcontrol
         virtual bool isTileValid(int x, int y, int z) const = 0;
         virtual QString query(int x, int y, int z) const = 0;
 
+        //! returns true if the tiles are read by the MapAdapter itself instead of being loaded from host()
+        virtual bool hasLocalTiles() const;
+
+        //! returns the encoded image of a tile, used if hasLocalTiles() is true
+        /*!
+         * This is called when the tile is painted, so it should return quickly.
+         * @return the encoded image, an empty array if there is no such tile
+         */
+        virtual QByteArray tileData(int x, int y, int z) const;
+
         QSize       mSize;
         QString     mServerHost;
         QString     mServerPath;
+        QStringList mServerHosts;
+        int         mTileGeneration;
 
         int         mTileSize;
         int         mMin_zoom;
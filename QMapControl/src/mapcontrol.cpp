@@ -85,8 +85,8 @@ namespace qmapcontrol
 
         mousepressed = false;
 
-        connect(m_imagemanager, SIGNAL(imageReceived()),
-                this, SLOT(updateRequestNew()));
+        connect(m_imagemanager, SIGNAL(tilesReceived(QList<TileKey>)),
+                this, SLOT(tilesReceived(QList<TileKey>)));
 
         connect(m_imagemanager, SIGNAL(loadingFinished()),
                 this, SLOT(loadingFinished()));
@@ -150,11 +150,12 @@ namespace qmapcontrol
         Point* point = dynamic_cast<Point*>(geom);
         if (point!=0)
         {
-            QPoint start = m_layermanager->layer()->mapadapter()->coordinateToDisplay(currentCoordinate());
-            QPoint dest = m_layermanager->layer()->mapadapter()->coordinateToDisplay(point->coordinate());
-            QPoint step = (dest-start);
+            QPointF start = m_layermanager->layer()->mapadapter()->coordinateToDisplayF(currentCoordinate());
+            QPointF dest = m_layermanager->layer()->mapadapter()->coordinateToDisplayF(point->coordinate());
+            QPoint step = (dest-start).toPoint();
             m_layermanager->scrollView(step);
-            updateRequestNew();
+            // the geometries did not change, so their cached drawing stays
+            m_layermanager->forceRedraw();
         }
     }
 
@@ -180,10 +181,11 @@ namespace qmapcontrol
             return;
         }
 
-        QPoint start = m_layermanager->layer()->mapadapter()->coordinateToDisplay(currentCoordinate());
-        QPoint dest = m_layermanager->layer()->mapadapter()->coordinateToDisplay(target);
+        QPointF start = m_layermanager->layer()->mapadapter()->coordinateToDisplayF(currentCoordinate());
+        QPointF dest = m_layermanager->layer()->mapadapter()->coordinateToDisplayF(target);
 
-        QPoint step = (dest-start)/steps;
+        // the map scrolls by whole pixels, rounding the remaining distance spreads the fractions over the steps
+        QPoint step = ((dest-start)/steps).toPoint();
         m_layermanager->scrollView(step);
 
         update();
@@ -201,7 +203,8 @@ namespace qmapcontrol
 
     void MapControl::paintEvent(QPaintEvent* evnt)
     {
-        Q_UNUSED(evnt);
+        // only the parts which were updated are drawn again
+        const QRect dirty = evnt->rect();
 
         if ( m_doubleBuffer == 0 )
         {
@@ -216,9 +219,10 @@ namespace qmapcontrol
 
         QPainter dbPainter;
         dbPainter.begin(m_doubleBuffer);
+        dbPainter.setClipRegion(evnt->region());
 
         m_layermanager->drawImage(&dbPainter);
-        m_layermanager->drawGeoms(&dbPainter);
+        m_layermanager->drawGeoms(&dbPainter, dirty);
 
         // draw scale
         if (scaleVisible)
@@ -275,7 +279,7 @@ namespace qmapcontrol
         dbPainter.end();
         QPainter painter;
         painter.begin( this );
-        painter.drawPixmap( rect(), *m_doubleBuffer, m_doubleBuffer->rect() );
+        painter.drawPixmap( dirty, *m_doubleBuffer, dirty );
         painter.end();
     }
 
@@ -332,13 +336,16 @@ namespace qmapcontrol
             QPoint offset = pre_click_px - QPoint(evnt->x(), evnt->y());
             m_layermanager->scrollView(offset);
             pre_click_px = QPoint(evnt->x(), evnt->y());
+            update();
         }
         else if (mousepressed && mymousemode == Dragging)
         {
+            // the old and the new selection rectangle
+            update(QRect(pre_click_px, current_mouse_pos).normalized().adjusted(-1, -1, 1, 1));
             current_mouse_pos = QPoint(evnt->x(), evnt->y());
+            update(QRect(pre_click_px, current_mouse_pos).normalized().adjusted(-1, -1, 1, 1));
         }
-
-        update();
+        // moving the mouse alone does not change the map
     }
 
     void MapControl::wheelEvent(QWheelEvent *evnt)
@@ -399,6 +406,8 @@ namespace qmapcontrol
 
     void MapControl::updateRequestNew()
     {
+        // changes which were not announced by the geometries are drawn, too
+        m_layermanager->invalidateStaticGeometries();
         m_layermanager->forceRedraw();
     }
 
@@ -493,6 +502,11 @@ namespace qmapcontrol
         m_layermanager->removeZoomImage();
     }
 
+    void MapControl::tilesReceived(const QList<TileKey>& tiles)
+    {
+        m_layermanager->drawTiles(tiles);
+    }
+
     void MapControl::addLayer(Layer* layer)
     {
         layer->setImageManager(m_imagemanager);
@@ -527,11 +541,41 @@ namespace qmapcontrol
         m_imagemanager->setCacheDir( path, qDiskSizeMB );
     }
 
+    void MapControl::setStaleWhileRevalidate( bool enabled )
+    {
+        m_imagemanager->setStaleWhileRevalidate( enabled );
+    }
+
+    void MapControl::setMemoryCacheSize( const int qMemorySizeMB )
+    {
+        m_imagemanager->tileCache()->setMaxBytes( qint64(qMemorySizeMB)*1024*1024 );
+    }
+
     void MapControl::setProxy(QString host, int port, const QString username, const QString password)
     {
         m_imagemanager->setProxy(host, port, username, password);
     }
 
+    void MapControl::setPrefetchRing(int tiles)
+    {
+        m_layermanager->setPrefetchRing(tiles);
+    }
+
+    int MapControl::prefetchRing() const
+    {
+        return m_layermanager->prefetchRing();
+    }
+
+    void MapControl::setPrefetchZoomLevels(bool enabled)
+    {
+        m_layermanager->setPrefetchZoomLevels(enabled);
+    }
+
+    bool MapControl::prefetchZoomLevels() const
+    {
+        return m_layermanager->prefetchZoomLevels();
+    }
+
     void MapControl::showScale(bool visible)
     {
         scaleVisible = visible;
@@ -594,10 +638,15 @@ namespace qmapcontrol
 
    bool MapControl::isGeometryVisible( Geometry * geometry)
    {
-       if ( !geometry || getViewport() == QRectF() )
+       if ( !geometry )
+           return false;
+
+       // the viewport is projected once, the bounding boxes of geometries are cached
+       const QRectF viewport = getViewport();
+       if ( viewport == QRectF() )
            return false;
 
-       return getViewport().contains( geometry->boundingBox() );
+       return viewport.contains( geometry->boundingBox() );
    }
 
    int MapControl::loadingQueueSize()
@@ -232,6 +232,22 @@ namespace qmapcontrol
          */
         void enablePersistentCache ( const QDir& path= QDir::homePath() + "/QMapControl.cache", const int qDiskSizeMB = 250 );
 
+        //! Shows map tiles of the persistent cache right away, even if they expired
+        /*!
+         * Expired tiles are revalidated with the tile server in the background
+         * and only replaced if they changed. This is useful with a slow or unreliable network.
+         * @param enabled true to show expired tiles, default is false
+         */
+        void setStaleWhileRevalidate ( bool enabled );
+
+        //! Sets how much memory the decoded map tiles may use
+        /*!
+         * The tiles of the visible map are kept even if they exceed this size.
+         * Quotas for single map layers can be set on ImageManager::tileCache().
+         * @param qMemorySizeMB the memory for map tiles in megabytes, default is 64
+         */
+        void setMemoryCacheSize ( const int qMemorySizeMB );
+
         //! Sets the proxy for HTTP connections
         /*!
          * This method sets the proxy for HTTP connections.
@@ -243,6 +259,28 @@ namespace qmapcontrol
          */
         void setProxy(QString host, int port, const QString username = QString(), const QString password = QString());
 
+        //! Sets how many tiles around the visible area are loaded in advance
+        /*!
+         * Prefetching starts when all visible tiles are loaded. The tiles are
+         * loaded around the screen and ahead in the direction the map is panned.
+         * The default is one tile, 0 disables prefetching.
+         * @param tiles the width of the prefetched ring in tiles
+         */
+        void setPrefetchRing( int tiles );
+
+        //! returns the width of the prefetched ring in tiles
+        int prefetchRing() const;
+
+        //! Sets whether the tiles of the next and previous zoom level are loaded in advance
+        /*!
+         * Only the tiles covering the current screen are prefetched for the neighbour zoom levels.
+         * @param enabled true to prefetch the neighbour zoom levels
+         */
+        void setPrefetchZoomLevels( bool enabled );
+
+        //! returns if the neighbour zoom levels are prefetched
+        bool prefetchZoomLevels() const;
+
         //! Displays the scale within the widget
         /*!
          *
@@ -430,6 +468,7 @@ namespace qmapcontrol
     private slots:
         void tick();
         void loadingFinished();
+        void tilesReceived(const QList<TileKey>& tiles);
         void positionChanged ( Geometry* geom );
 
     };
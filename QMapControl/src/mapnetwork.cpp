@@ -24,58 +24,85 @@
 */
 
 #include "mapnetwork.h"
+#include "mapadapter.h"
 #include <QNetworkRequest>
 #include <QUrl>
 #include <QMapIterator>
 #include <QWaitCondition>
+#include <QTimer>
+#include <QPair>
+#include <QSet>
+#include <QDateTime>
+#include <QAbstractNetworkCache>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QNetworkCacheMetaData>
+#include <algorithm>
 
 #include <QMutexLocker>
 
+// failed requests in a row after which a host is not requested for a while
+static const int kHostFailureThreshold = 5;
+static const int kHostRetryDelayMs = 10000;
+static const int kMaxHostRetryDelayMs = 300000;
+
+namespace
+{
+    typedef QPair<qint64, qmapcontrol::TileKey> QueuedTile;
+
+    bool closerToMiddle(const QueuedTile& a, const QueuedTile& b)
+    {
+        return a.first < b.first;
+    }
+
+    // errors about the requested content are answers of a working host
+    bool hostResponded(QNetworkReply::NetworkError error)
+    {
+        return error == QNetworkReply::NoError ||
+               (error >= QNetworkReply::ContentAccessDenied && error <= QNetworkReply::UnknownContentError);
+    }
+}
+
 namespace qmapcontrol
 {
     MapNetwork::MapNetwork(ImageManager* parent)
         :   parent(parent), 
             http(new QNetworkAccessManager(this)),
+            tileDecoder(new TileDecoder(this)),
+            maxPerHost(6),
+            prefetching(0),
+            revalidating(0),
+            requestsScheduled(false),
             loaded(0),
             networkActive( false ),
-            cacheEnabled(false)
+            cacheEnabled(false),
+            http2Allowed(true),
+            staleWhileRevalidate(false)
     {
         connect(http, SIGNAL(finished(QNetworkReply *)), this, SLOT(requestFinished(QNetworkReply *)));
     }
 
     MapNetwork::~MapNetwork()
     {
-        foreach(QNetworkReply *reply, replyList)
-        {
-            if(reply->isRunning())
-            {
-                reply->abort();
-            }
-            reply->deleteLater();
-            reply = 0;
-        }
+        abortLoading();
+
+        delete tileDecoder;
+        tileDecoder = 0;
 
         http->deleteLater();
         http = 0;
     }
 
-    void MapNetwork::loadImage(const QString& host, const QString& url)
+    void MapNetwork::loadImage(const QString& host, const QString& url, const TileKey& tile, bool prefetch)
     {
-        QString hostName = host;
-        QString portNumber = QString("80");
-
-        QRegExp r(".:.");
-
-        if(r.indexIn(host) >= 0)
+        QMutexLocker lock(&vectorMutex);
+        if (loadingTiles.contains(tile) || parkedTiles.contains(tile))
         {
-            QStringList s = host.split(":");
-
-            hostName = s.at(0);
-            portNumber = s.at(1);
+            return;
         }
 
-        QString finalUrl = QString("http://%1:%2%3").arg(hostName).arg(portNumber).arg(url);
-        QNetworkRequest request = QNetworkRequest(QUrl(finalUrl));
+        const QString base = baseUrl(host);
+        QNetworkRequest request = QNetworkRequest(QUrl(base + url));
 
         if( cacheEnabled )
         {
@@ -85,12 +112,256 @@ namespace qmapcontrol
             request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
         }
 
-        request.setRawHeader("User-Agent", "Mozilla/5.0 (PC; U; Intel; Linux; en) AppleWebKit/420+ (KHTML, like Gecko)");
+#if QT_VERSION >= 0x050F00
+        request.setAttribute( QNetworkRequest::Http2AllowedAttribute, http2Allowed );
+#elif QT_VERSION >= 0x050800
+        request.setAttribute( QNetworkRequest::HTTP2AllowedAttribute, http2Allowed );
+#endif
+
+        request.setRawHeader("User-Agent", userAgent());
+
+        // the request is only queued here, startRequests() sends it once all tiles of this paint are known
+        LoadingTile loading;
+        loading.tile = tile;
+        loading.url = url;
+        loading.hostKey = base;
+        loading.reply = 0;
+        loading.decoding = false;
+        loading.prefetch = prefetch;
+        loading.fromCache = false;
+        loading.stale = false;
+        loading.revalidate = false;
+
+        if( cacheEnabled && staleWhileRevalidate )
+        {
+            // a cached tile is shown right away, even if it expired, and checked for changes afterwards
+            const QNetworkCacheMetaData metaData = http->cache()->metaData(request.url());
+            if (metaData.isValid())
+            {
+                request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysCache );
+                loading.fromCache = true;
+                loading.stale = !metaData.expirationDate().isValid() ||
+                                metaData.expirationDate() < QDateTime::currentDateTime();
+            }
+        }
+
+        loading.request = request;
+        loadingTiles.insert(tile, loading);
+        if (prefetch)
+        {
+            ++prefetching;
+        }
+
+        scheduleRequests();
+    }
+
+    QString MapNetwork::baseUrl(const QString& host)
+    {
+        QHash<QString, QString>::const_iterator it = hostUrls.constFind(host);
+        if (it != hostUrls.constEnd())
+        {
+            return it.value();
+        }
+
+        const QString base = hostBaseUrl(host);
+        hostUrls.insert(host, base);
+        return base;
+    }
+
+    QString MapNetwork::hostBaseUrl(const QString& host)
+    {
+        // hosts without a scheme are plain HTTP, like "tile.example.org" or "tile.example.org:8080"
+        const QUrl url(host.contains("://") ? host : QString("http://%1").arg(host));
+        const QString scheme = url.scheme().toLower();
+        const int port = url.port(scheme == "https" ? 443 : 80);
+
+        QString path = url.path();
+        while (path.endsWith('/'))
+        {
+            path.chop(1);
+        }
+
+        return QString("%1://%2:%3%4").arg(scheme).arg(url.host()).arg(port).arg(path);
+    }
+
+    QByteArray MapNetwork::userAgent()
+    {
+        QByteArray agent;
+        const QString application = QCoreApplication::applicationName();
+        if (!application.isEmpty())
+        {
+            agent += application.toUtf8();
+            if (!QCoreApplication::applicationVersion().isEmpty())
+            {
+                agent += '/' + QCoreApplication::applicationVersion().toUtf8();
+            }
+            agent += ' ';
+        }
+        return agent + "QMapControl (Qt " QT_VERSION_STR ")";
+    }
 
+    void MapNetwork::raisePriority(const TileKey& tile)
+    {
         QMutexLocker lock(&vectorMutex);
-        replyList.append( http->get(request) );
-        loadingMap.insert( finalUrl, url );
-}
+        QHash<TileKey, LoadingTile>::iterator it = loadingTiles.find(tile);
+        if (it != loadingTiles.end() && it.value().prefetch)
+        {
+            it.value().prefetch = false;
+            --prefetching;
+            scheduleRequests();
+        }
+        else if (it != loadingTiles.end() && it.value().revalidate)
+        {
+            // the shown tile was dropped from the memory, so the result is needed even if nothing changed
+            it.value().revalidate = false;
+            --revalidating;
+            scheduleRequests();
+        }
+        else if (parkedTiles.contains(tile))
+        {
+            // counted as soon as the host works again
+            parkedTiles[tile].prefetch = false;
+            parkedTiles[tile].revalidate = false;
+        }
+    }
+
+    void MapNetwork::scheduleRequests()
+    {
+        if (!requestsScheduled)
+        {
+            requestsScheduled = true;
+            QTimer::singleShot(0, this, SLOT(startRequests()));
+        }
+    }
+
+    void MapNetwork::startRequests()
+    {
+        QMutexLocker lock(&vectorMutex);
+        requestsScheduled = false;
+
+        // a parked tile probes if a host works again, unless one of its tiles is queued anyway
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QSet<QString> probes;
+        QHashIterator<QString, HostState> hostIt(hostStates);
+        while (hostIt.hasNext())
+        {
+            hostIt.next();
+            if (hostIt.value().open && now >= hostIt.value().retryAt && runningPerHost.value(hostIt.key()) == 0)
+            {
+                probes.insert(hostIt.key());
+            }
+        }
+        if (!probes.isEmpty())
+        {
+            QHashIterator<TileKey, LoadingTile> loadingIt(loadingTiles);
+            while (loadingIt.hasNext())
+            {
+                probes.remove(loadingIt.next().value().hostKey);
+            }
+            foreach(const QString& hostKey, probes)
+            {
+                unparkTiles(hostKey, 1);
+            }
+        }
+
+        QVector<QueuedTile> queued;
+        QHashIterator<TileKey, LoadingTile> it(loadingTiles);
+        while (it.hasNext())
+        {
+            it.next();
+            if (it.value().reply == 0 && !it.value().decoding)
+            {
+                // prefetched tiles are queued behind all visible ones, revalidations of shown tiles come last
+                const qint64 priorityOffset = it.value().revalidate ? Q_INT64_C(1) << 62 :
+                                              it.value().prefetch ? Q_INT64_C(1) << 61 : 0;
+                queued.append(qMakePair(distanceToMiddle(it.value()) + priorityOffset, it.key()));
+            }
+        }
+
+        // tiles next to the middle of the map are requested first
+        std::sort(queued.begin(), queued.end(), closerToMiddle);
+
+        bool parkedVisible = false;
+        foreach(const QueuedTile& queuedTile, queued)
+        {
+            // every running request ends up in the decoder, so it must not be flooded
+            if (loadingReplies.size() + tileDecoder->pendingCount() >= tileDecoder->maxPending())
+            {
+                break;
+            }
+
+            LoadingTile& loading = loadingTiles[queuedTile.second];
+
+            // reading the disk cache needs neither a connection nor a working host
+            if (!loading.fromCache)
+            {
+                int& running = runningPerHost[loading.hostKey];
+                // prefetching leaves half of the connections free for tiles which become visible
+                const int maxRunning = loading.prefetch || loading.revalidate ? qMax(1, maxPerHost/2) : maxPerHost;
+                if (isHostBlocked(loading.hostKey, running, now))
+                {
+                    parkedVisible = parkedVisible || (!loading.prefetch && !loading.revalidate);
+                    parkTile(queuedTile.second);
+                    continue;
+                }
+                if (running >= maxRunning)
+                {
+                    continue;
+                }
+                ++running;
+            }
+
+            loading.reply = http->get(loading.request);
+            loadingReplies.insert(loading.reply, loading.tile);
+        }
+
+        // the map does not wait for the tiles of a host which does not work
+        const bool empty = parkedVisible && loadingTiles.size() - prefetching - revalidating == 0;
+        lock.unlock();
+        if (empty)
+        {
+            parent->loadingQueueEmpty();
+        }
+    }
+
+    void MapNetwork::parkTile(const TileKey& tile)
+    {
+        const LoadingTile loading = loadingTiles.take(tile);
+        if (loading.prefetch)
+        {
+            --prefetching;
+        }
+        if (loading.revalidate)
+        {
+            --revalidating;
+        }
+        parkedTiles.insert(tile, loading);
+    }
+
+    void MapNetwork::unparkTiles(const QString& hostKey, int count)
+    {
+        QMutableHashIterator<TileKey, LoadingTile> it(parkedTiles);
+        while (it.hasNext() && count != 0)
+        {
+            it.next();
+            if (it.value().hostKey != hostKey)
+            {
+                continue;
+            }
+
+            if (it.value().prefetch)
+            {
+                ++prefetching;
+            }
+            if (it.value().revalidate)
+            {
+                ++revalidating;
+            }
+            loadingTiles.insert(it.key(), it.value());
+            it.remove();
+            --count;
+        }
+    }
 
     void MapNetwork::requestFinished(QNetworkReply *reply)
     {
@@ -101,63 +372,272 @@ namespace qmapcontrol
         }
 
         //qDebug() << "MapNetwork::requestFinished" << reply->url().toString();
-        if (reply->error() == QNetworkReply::NoError)
+        bool idInMap = false;
+        bool decoding = false;
+        bool prefetched = false;
+        bool revalidated = false;
+        bool requeued = false;
+        QString url;
+        QString hostKey;
+        int hostChange = 0;
+        TileKey tile;
+        QByteArray data;
         {
-            QString id = reply->url().toString();
-            // check if id is in map?
-            bool idInMap = false;
-            QString url;
-            {
-                QMutexLocker lock(&vectorMutex);
-                idInMap = loadingMap.contains(id);
-                if(idInMap)
-                {
-                    url = loadingMap[id];
-                    loadingMap.remove(id);
-                }
-            }
-          
+            QMutexLocker lock(&vectorMutex);
+            QHash<QNetworkReply*, TileKey>::iterator it = loadingReplies.find(reply);
+            idInMap = (it != loadingReplies.end());
             if (idInMap)
             {
-                //qDebug() << "request finished for reply: " << reply << ", belongs to: " << url << endl;
-                QByteArray ax;
-
-                if (reply->bytesAvailable()>0)
+                tile = it.value();
+                QHash<TileKey, LoadingTile>::iterator tileIt = loadingTiles.find(tile);
+                if (tileIt != loadingTiles.end())
                 {
-                    QPixmap pm;
-                    ax = reply->readAll();
+                    LoadingTile& loading = tileIt.value();
+                    url = loading.url;
+                    prefetched = loading.prefetch;
+                    revalidated = loading.revalidate;
+                    loading.reply = 0;
 
-                    if (pm.loadFromData(ax) && pm.size().width() > 1 && pm.size().height() > 1)
+                    if (loading.fromCache)
                     {
-                        loaded += pm.size().width()*pm.size().height()*pm.depth()/8/1024;
-                        //qDebug() << "Network loaded: " << loaded << " width:" << pm.size().width() << " height:" <<pm.size().height();
-                        parent->receivedImage(pm, url);
+                        if (reply->error() != QNetworkReply::NoError)
+                        {
+                            // the tile was dropped from the disk cache meanwhile, so it is loaded from the network
+                            loading.fromCache = false;
+                            loading.stale = false;
+                            loading.request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache );
+                            requeued = true;
+                            scheduleRequests();
+                        }
                     }
                     else
                     {
-                        parent->fetchFailed(url);
+                        hostKey = loading.hostKey;
+                        --runningPerHost[hostKey];
+                        hostChange = updateHostState(hostKey, hostResponded(reply->error()));
+                        if (hostChange > 0)
+                        {
+                            unparkTiles(hostKey);
+                            scheduleRequests();
+                        }
+                    }
+
+                    if (reply->error() == QNetworkReply::NoError)
+                    {
+                        data = reply->readAll();
+                    }
+
+                    // a revalidation which is answered by the disk cache (304 Not Modified) or
+                    // which returns the same data leaves the shown tile as it is
+                    const bool changed = !revalidated ||
+                            (!reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() &&
+                             QCryptographicHash::hash(data, QCryptographicHash::Sha1) != loading.cachedDigest);
+
+                    // the tile stays in the queue until it is decoded, so it is not requested twice
+                    decoding = !requeued && !data.isEmpty() && changed;
+                    if (decoding)
+                    {
+                        loading.decoding = true;
+                        if (loading.stale)
+                        {
+                            loading.cachedDigest = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+                        }
+                    }
+                    else if (!requeued)
+                    {
+                        if (prefetched)
+                        {
+                            --prefetching;
+                        }
+                        if (revalidated)
+                        {
+                            --revalidating;
+                        }
+                        loadingTiles.erase(tileIt);
                     }
                 }
+                loadingReplies.erase(it);
             }
         }
 
-        if (loadQueueSize() == 0)
+        if (hostChange != 0)
         {
-            //qDebug () << "all loaded";
-            parent->loadingQueueEmpty();
+            parent->hostAvailabilityChanged(hostKey, hostChange > 0);
         }
 
-        QMutexLocker lock(&vectorMutex);
-        replyList.removeAll(reply);
+        // replies which are not indexed anymore were cancelled, nothing to report
+        if (idInMap && !requeued)
+        {
+            if (decoding)
+            {
+                //qDebug() << "request finished for reply: " << reply << ", belongs to: " << url << endl;
+                tileDecoder->decode(tile, data);
+
+                // a connection became free for the next queued tile
+                QMutexLocker lock(&vectorMutex);
+                scheduleRequests();
+            }
+            else if (revalidated)
+            {
+                // the shown tile is still up to date, or stays shown if the server cannot be asked
+                tileFinished(true);
+            }
+            else
+            {
+                qDebug() << "MapNetwork::requestFinished() - cannot load" << url << reply->errorString();
+                parent->fetchFailed(tile);
+                tileFinished(prefetched);
+            }
+        }
 
         reply->deleteLater();
         reply = 0;
     }
 
+    void MapNetwork::tileDecoded(const TileKey& tile, const QImage& image)
+    {
+        bool prefetched = false;
+        bool revalidated = false;
+        QString url;
+        const bool decoded = !image.isNull() && image.width() > 1 && image.height() > 1;
+        {
+            QMutexLocker lock(&vectorMutex);
+            QHash<TileKey, LoadingTile>::iterator it = loadingTiles.find(tile);
+            if (it == loadingTiles.end() || !it.value().decoding)
+            {
+                // the tile was cancelled while it was decoded, its decoder slot is free anyway
+                scheduleRequests();
+                return;
+            }
+
+            LoadingTile& loading = it.value();
+            url = loading.url;
+            prefetched = loading.prefetch;
+            revalidated = loading.revalidate;
+            if (prefetched)
+            {
+                --prefetching;
+            }
+            if (revalidated)
+            {
+                --revalidating;
+            }
+
+            if (decoded && loading.stale)
+            {
+                // the expired tile is shown now, the server is asked if it changed; Qt adds
+                // If-None-Match and If-Modified-Since from the cached headers to the request
+                loading.request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork );
+                loading.fromCache = false;
+                loading.stale = false;
+                loading.decoding = false;
+                loading.prefetch = false;
+                loading.revalidate = true;
+                ++revalidating;
+                scheduleRequests();
+            }
+            else
+            {
+                loadingTiles.erase(it);
+            }
+        }
+
+        if (decoded)
+        {
+            QPixmap pm = QPixmap::fromImage(image);
+            loaded += pm.size().width()*pm.size().height()*pm.depth()/8/1024;
+            //qDebug() << "Network loaded: " << loaded << " width:" << pm.size().width() << " height:" <<pm.size().height();
+            parent->receivedImage(pm, tile, prefetched);
+        }
+        else
+        {
+            qDebug() << "MapNetwork::tileDecoded() - cannot decode" << url;
+            if (!revalidated)
+            {
+                parent->fetchFailed(tile);
+            }
+        }
+
+        tileFinished(prefetched || revalidated);
+    }
+
+    int MapNetwork::updateHostState(const QString& hostKey, bool responded)
+    {
+        HostState& state = hostStates[hostKey];
+        if (responded)
+        {
+            state.failures = 0;
+            state.openings = 0;
+            if (state.open)
+            {
+                state.open = false;
+                return 1;
+            }
+            return 0;
+        }
+
+        ++state.failures;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (state.open ? now < state.retryAt : state.failures < kHostFailureThreshold)
+        {
+            // requests which were running when the host was given up do not extend the delay
+            return 0;
+        }
+
+        // too many failures in a row or a failed probe, the delay doubles each time
+        const int delay = qMin(kHostRetryDelayMs << qMin(state.openings, 10), kMaxHostRetryDelayMs);
+        ++state.openings;
+        state.retryAt = now + delay;
+        QTimer::singleShot(delay, this, SLOT(startRequests()));
+
+        const bool opened = !state.open;
+        state.open = true;
+        return opened ? -1 : 0;
+    }
+
+    bool MapNetwork::isHostBlocked(const QString& hostKey, int running, qint64 now) const
+    {
+        QHash<QString, HostState>::const_iterator it = hostStates.constFind(hostKey);
+        if (it == hostStates.constEnd() || !it->open)
+        {
+            return false;
+        }
+
+        // after the delay a single request probes if the host works again
+        return now < it->retryAt || running > 0;
+    }
+
+    bool MapNetwork::isHostAvailable(const QString& host) const
+    {
+        QMutexLocker lock(&vectorMutex);
+        QHash<QString, HostState>::const_iterator it = hostStates.constFind(hostBaseUrl(host));
+        return it == hostStates.constEnd() || !it->open;
+    }
+
+    void MapNetwork::tileFinished(bool prefetched)
+    {
+        if (loadQueueSize() == 0 && !prefetched)
+        {
+            //qDebug () << "all loaded";
+            parent->loadingQueueEmpty();
+        }
+        else
+        {
+            // a connection or a decoder slot became free for the next queued tile
+            QMutexLocker lock(&vectorMutex);
+            scheduleRequests();
+        }
+    }
+
+    TileDecoder* MapNetwork::decoder() const
+    {
+        return tileDecoder;
+    }
+
     int MapNetwork::loadQueueSize() const
     {
         QMutexLocker lock(&vectorMutex);
-        return loadingMap.size();
+        return loadingTiles.size() - prefetching - revalidating;
     }
 
     void MapNetwork::setDiskCache(QNetworkDiskCache *qCache)
@@ -172,30 +652,350 @@ namespace qmapcontrol
     void MapNetwork::abortLoading()
     {
         //qDebug() << "MapNetwork::abortLoading";
-        // be sure that replyList is copied in case it's modified in another thread
-        QListIterator<QNetworkReply *> iter(replyList);
-        while(iter.hasNext())
+        QList<TileKey> tiles;
+        {
+            QMutexLocker lock(&vectorMutex);
+            tiles = loadingTiles.keys() + parkedTiles.keys();
+        }
+        cancelTiles(tiles);
+    }
+
+    void MapNetwork::cancelTiles(const QList<TileKey>& tiles)
+    {
+        // detach the tiles from the index first, aborting emits finished() which must not find the replies anymore
+        QList<QNetworkReply*> replies;
+        {
+            QMutexLocker lock(&vectorMutex);
+            foreach(const TileKey& tile, tiles)
+            {
+                QHash<TileKey, LoadingTile>::iterator it = loadingTiles.find(tile);
+                if (it == loadingTiles.end())
+                {
+                    parkedTiles.remove(tile);
+                    continue;
+                }
+
+                if (it.value().reply)
+                {
+                    replies.append(it.value().reply);
+                    loadingReplies.remove(it.value().reply);
+                    if (!it.value().fromCache)
+                    {
+                        --runningPerHost[it.value().hostKey];
+                    }
+                }
+                if (it.value().prefetch)
+                {
+                    --prefetching;
+                }
+                if (it.value().revalidate)
+                {
+                    --revalidating;
+                }
+                loadingTiles.erase(it);
+            }
+        }
+
+        foreach(QNetworkReply *reply, replies)
+        {
+            if(reply->isRunning())
+            {
+                reply->abort();
+            }
+            reply->deleteLater();
+            reply = 0;
+        }
+    }
+
+    void MapNetwork::setViewport(const MapAdapter* adapter, int zoom, bool reversedZoom, int tilesize, const QRect& viewport, const QPoint& middle)
+    {
+        QList<TileKey> outside;
         {
-            QNetworkReply *reply = iter.next();
-            if (reply)
+            QMutexLocker lock(&vectorMutex);
+            const bool known = viewports.contains(adapter);
+            TileViewport& tileViewport = viewports[adapter];
+
+            // keep the prefetch area on the same tiles when the zoom changed
+            const int zoomChange = known ? (zoom - tileViewport.zoom) * tileViewport.zoomDirection : 0;
+            if (!known || zoomChange < -1 || zoomChange > 1)
+            {
+                tileViewport.prefetchArea = QRect();
+            }
+            else if (zoomChange == 1)
+            {
+                const QRect area = tileViewport.prefetchArea;
+                tileViewport.prefetchArea = QRect(area.topLeft()*2, area.size()*2);
+            }
+            else if (zoomChange == -1)
+            {
+                const QRect area = tileViewport.prefetchArea;
+                tileViewport.prefetchArea = QRect(area.topLeft()/2, area.size()/2);
+            }
+
+            tileViewport.zoom = zoom;
+            tileViewport.zoomDirection = reversedZoom ? -1 : 1;
+            tileViewport.tilesize = tilesize;
+            tileViewport.viewport = viewport;
+            tileViewport.middle = middle;
+
+            QMutableHashIterator<TileKey, LoadingTile> it(loadingTiles);
+            while (it.hasNext())
+            {
+                it.next();
+                if (it.key().adapter != adapter)
+                {
+                    continue;
+                }
+
+                if (it.value().prefetch && isInViewport(it.value()))
+                {
+                    // the prefetched tile is visible now
+                    it.value().prefetch = false;
+                    --prefetching;
+                }
+                else if (it.value().prefetch ? !isInPrefetchArea(it.value()) : !isInViewport(it.value()))
+                {
+                    outside.append(it.key());
+                }
+            }
+
+            QMutableHashIterator<TileKey, LoadingTile> parkedIt(parkedTiles);
+            while (parkedIt.hasNext())
             {
-                if(reply->isRunning())
+                parkedIt.next();
+                if (parkedIt.key().adapter != adapter)
+                {
+                    continue;
+                }
+
+                if (parkedIt.value().prefetch && isInViewport(parkedIt.value()))
+                {
+                    parkedIt.value().prefetch = false;
+                }
+                else if (parkedIt.value().prefetch ? !isInPrefetchArea(parkedIt.value()) : !isInViewport(parkedIt.value()))
                 {
-                    reply->abort();
+                    parkedIt.remove();
                 }
-                reply->deleteLater();
-                reply = 0;
+            }
+
+            if (!loadingTiles.isEmpty())
+            {
+                // the middle moved, queued tiles have to be sorted again
+                scheduleRequests();
             }
         }
+
+        cancelTiles(outside);
+    }
+
+    void MapNetwork::setPrefetchArea(const MapAdapter* adapter, const QRect& area)
+    {
+        QList<TileKey> outside;
+        {
+            QMutexLocker lock(&vectorMutex);
+            if (!viewports.contains(adapter))
+            {
+                return;
+            }
+            viewports[adapter].prefetchArea = area;
+
+            QHashIterator<TileKey, LoadingTile> it(loadingTiles);
+            while (it.hasNext())
+            {
+                it.next();
+                if (it.key().adapter == adapter && it.value().prefetch && !isInPrefetchArea(it.value()))
+                {
+                    outside.append(it.key());
+                }
+            }
+
+            QMutableHashIterator<TileKey, LoadingTile> parkedIt(parkedTiles);
+            while (parkedIt.hasNext())
+            {
+                parkedIt.next();
+                if (parkedIt.key().adapter == adapter && parkedIt.value().prefetch && !isInPrefetchArea(parkedIt.value()))
+                {
+                    parkedIt.remove();
+                }
+            }
+        }
+
+        cancelTiles(outside);
+    }
+
+    void MapNetwork::removeAdapter(const QObject* adapter)
+    {
+        QList<TileKey> tiles;
+        {
+            QMutexLocker lock(&vectorMutex);
+            QHashIterator<TileKey, LoadingTile> it(loadingTiles);
+            while (it.hasNext())
+            {
+                it.next();
+                if (static_cast<const QObject*>(it.key().adapter) == adapter)
+                {
+                    tiles.append(it.key());
+                }
+            }
+
+            QMutableHashIterator<TileKey, LoadingTile> parkedIt(parkedTiles);
+            while (parkedIt.hasNext())
+            {
+                if (static_cast<const QObject*>(parkedIt.next().key().adapter) == adapter)
+                {
+                    parkedIt.remove();
+                }
+            }
+
+            QMutableHashIterator<const MapAdapter*, TileViewport> viewportIt(viewports);
+            while (viewportIt.hasNext())
+            {
+                if (static_cast<const QObject*>(viewportIt.next().key()) == adapter)
+                {
+                    viewportIt.remove();
+                }
+            }
+        }
+
+        cancelTiles(tiles);
+    }
+
+    bool MapNetwork::isInViewport(const LoadingTile& loading) const
+    {
+        QHash<const MapAdapter*, TileViewport>::const_iterator it = viewports.constFind(loading.tile.adapter);
+        if (it == viewports.constEnd())
+        {
+            return true;
+        }
+
+        if (loading.tile.z != it->zoom)
+        {
+            return false;
+        }
+
+        const int tilesize = it->tilesize;
+        return it->viewport.contains(QPoint(loading.tile.x * tilesize + tilesize/2,
+                                            loading.tile.y * tilesize + tilesize/2));
+    }
+
+    bool MapNetwork::isInPrefetchArea(const LoadingTile& loading) const
+    {
+        QHash<const MapAdapter*, TileViewport>::const_iterator it = viewports.constFind(loading.tile.adapter);
+        if (it == viewports.constEnd())
+        {
+            return true;
+        }
+
+        const int tilesize = it->tilesize;
+        QRect tileRect(loading.tile.x * tilesize, loading.tile.y * tilesize, tilesize, tilesize);
+
+        // tiles of the neighbour zoom levels are compared in display coordinates of the current zoom
+        const int zoomDifference = (loading.tile.z - it->zoom) * it->zoomDirection;
+        if (zoomDifference == 1)
+        {
+            tileRect = QRect(tileRect.topLeft()/2, tileRect.size()/2);
+        }
+        else if (zoomDifference == -1)
+        {
+            tileRect = QRect(tileRect.topLeft()*2, tileRect.size()*2);
+        }
+        else if (zoomDifference != 0)
+        {
+            return false;
+        }
+
+        return it->prefetchArea.intersects(tileRect);
+    }
+
+    qint64 MapNetwork::distanceToMiddle(const LoadingTile& loading) const
+    {
+        QHash<const MapAdapter*, TileViewport>::const_iterator it = viewports.constFind(loading.tile.adapter);
+        if (it == viewports.constEnd())
+        {
+            return 0;
+        }
+
+        const qint64 tilesize = it->tilesize;
+        const qint64 dx = loading.tile.x * tilesize + tilesize/2 - it->middle.x();
+        const qint64 dy = loading.tile.y * tilesize + tilesize/2 - it->middle.y();
+        return dx*dx + dy*dy;
+    }
+
+    void MapNetwork::setMaxConnectionsPerHost(int maxConnections)
+    {
         QMutexLocker lock(&vectorMutex);
-        replyList.clear();
-        loadingMap.clear();
+        maxPerHost = qMax(1, maxConnections);
+        scheduleRequests();
+    }
+
+    int MapNetwork::maxConnectionsPerHost() const
+    {
+        return maxPerHost;
+    }
+
+    void MapNetwork::setHttp2Allowed(bool allowed)
+    {
+        QMutexLocker lock(&vectorMutex);
+        http2Allowed = allowed;
+    }
+
+    bool MapNetwork::isHttp2Allowed() const
+    {
+        return http2Allowed;
+    }
+
+    void MapNetwork::setStaleWhileRevalidate(bool enabled)
+    {
+        QMutexLocker lock(&vectorMutex);
+        staleWhileRevalidate = enabled;
+    }
+
+    bool MapNetwork::isStaleWhileRevalidate() const
+    {
+        return staleWhileRevalidate;
+    }
+
+    QHash<QString, int> MapNetwork::runningRequests() const
+    {
+        QMutexLocker lock(&vectorMutex);
+        QHash<QString, int> running;
+        QHashIterator<QString, int> it(runningPerHost);
+        while (it.hasNext())
+        {
+            it.next();
+            if (it.value() > 0)
+            {
+                running.insert(it.key(), it.value());
+            }
+        }
+        return running;
+    }
+
+    QHash<QString, int> MapNetwork::queuedRequests() const
+    {
+        QMutexLocker lock(&vectorMutex);
+        QHash<QString, int> queued;
+        QHashIterator<TileKey, LoadingTile> it(loadingTiles);
+        while (it.hasNext())
+        {
+            it.next();
+            if (it.value().reply == 0 && !it.value().decoding)
+            {
+                ++queued[it.value().hostKey];
+            }
+        }
+        QHashIterator<TileKey, LoadingTile> parkedIt(parkedTiles);
+        while (parkedIt.hasNext())
+        {
+            ++queued[parkedIt.next().value().hostKey];
+        }
+        return queued;
     }
 
-    bool MapNetwork::imageIsLoading(QString url)
+    bool MapNetwork::imageIsLoading(const TileKey& tile) const
     {
         QMutexLocker lock(&vectorMutex);
-        return loadingMap.values().contains(url);
+        return loadingTiles.contains(tile) || parkedTiles.contains(tile);
     }
 
     void MapNetwork::setProxy(const QString host, const int port, const QString username, const QString password)
@@ -36,7 +36,12 @@
 #include <QVector>
 #include <QPixmap>
 #include <QMutex>
+#include <QHash>
+#include <QRect>
+#include <QNetworkRequest>
 #include "imagemanager.h"
+#include "tilekey.h"
+#include "tiledecoder.h"
 
 /**
         @author Kai Winter <kaiwinter@gmx.de>
@@ -52,25 +57,128 @@ namespace qmapcontrol
         MapNetwork(ImageManager* parent);
         ~MapNetwork();
 
-        void loadImage(const QString& host, const QString& url);
+        //! queues a tile for loading
+        /*!
+         * Prefetched tiles are loaded after all other tiles and do not count to the load queue.
+         * @param host the host of the tile, optionally with scheme, port and path prefix ("https://tile.example.org:8443/tiles"), default is HTTP on port 80
+         * @param url the path of the tile
+         * @param tile the key of the tile
+         * @param prefetch true if the tile is not visible yet
+         */
+        void loadImage(const QString& host, const QString& url, const TileKey& tile, bool prefetch = false);
+
+        //! turns a queued prefetch tile into a regular one
+        /*!
+         * This is used when a tile which is already prefetched becomes visible.
+         * @param tile the key of the tile
+         */
+        void raisePriority(const TileKey& tile);
 
         /*!
-         * checks if the given url is already loading
-         * @param url the url of the image
+         * checks if the given tile is already loading
+         * @param tile the key of the tile
          * @return boolean, if the image is already loading
          */
-        bool imageIsLoading(QString url);
+        bool imageIsLoading(const TileKey& tile) const;
 
         /*!
          * Aborts all current loading threads.
          * This is useful when changing the zoom-factor, though newly needed images loads faster
          */
         void abortLoading();
+
+        //! sets the viewport the tiles of a MapAdapter are loaded for
+        /*!
+         * Pending tiles of the MapAdapter are requested in order of their distance to the middle of the viewport.
+         * Tiles which are not within the viewport or belong to another zoom level are cancelled,
+         * no matter if they are still queued or already being downloaded.
+         * @param adapter the MapAdapter which forms the tiles
+         * @param zoom the current zoom of the MapAdapter
+         * @param reversedZoom true if the MapAdapter counts its zoom levels down (minZoom() > maxZoom())
+         * @param tilesize the tile size of the MapAdapter
+         * @param viewport the offscreen viewport in display coordinates
+         * @param middle the middle of the map in display coordinates
+         */
+        void setViewport(const MapAdapter* adapter, int zoom, bool reversedZoom, int tilesize, const QRect& viewport, const QPoint& middle);
+
+        //! sets the area in which prefetched tiles of a MapAdapter are kept
+        /*!
+         * Prefetched tiles outside of the area are cancelled. Prefetched tiles of the zoom levels
+         * directly above and below the current one are kept if they cover the area.
+         * @param adapter the MapAdapter which forms the tiles
+         * @param area the prefetch area in display coordinates of the current zoom, an empty area cancels all prefetched tiles
+         */
+        void setPrefetchArea(const MapAdapter* adapter, const QRect& area);
+
+        //! cancels the tiles of a MapAdapter and forgets its viewport
+        /*!
+         * The adapter is only compared, so this can be called while it is destroyed.
+         * @param adapter the MapAdapter which formed the tiles
+         */
+        void removeAdapter(const QObject* adapter);
+
+        //! sets how many requests are sent to one host at the same time
+        /*!
+         * Further tiles of the host are queued until a request finishes.
+         * @param maxConnections the number of parallel requests per host, default is 6
+         */
+        void setMaxConnectionsPerHost(int maxConnections);
+        int maxConnectionsPerHost() const;
+
+        //! allows HTTP/2 for the tile requests
+        /*!
+         * With HTTP/2 the requests to a host share one connection. This needs Qt 5.8 or newer
+         * and a server which supports it, otherwise HTTP/1.1 with persistent connections is used.
+         * @param allowed true to allow HTTP/2, default is true
+         */
+        void setHttp2Allowed(bool allowed);
+        bool isHttp2Allowed() const;
+
+        //! shows tiles from the disk cache right away, even if they expired
+        /*!
+         * Expired tiles are revalidated afterwards with a conditional request at the lowest priority.
+         * A tile is only replaced if the server sends different data.
+         * Without a disk cache this has no effect.
+         * @param enabled true to show expired tiles, default is false
+         */
+        void setStaleWhileRevalidate(bool enabled);
+        bool isStaleWhileRevalidate() const;
+
+        //! returns false while a host is not requested because its requests failed
+        /*!
+         * After several failed requests in a row a host is not requested for a while.
+         * Then a single request probes if it works again; the delay doubles with each failed probe.
+         * Tiles of the host are parked meanwhile, they are not counted by loadQueueSize()
+         * and are queued again when the host works again.
+         * @param host the host, optionally with scheme, port and path prefix
+         * @return true if tiles are requested from the host
+         */
+        bool isHostAvailable(const QString& host) const;
+
+        //! returns the number of running requests per "scheme://host:port"
+        QHash<QString, int> runningRequests() const;
+
+        //! returns the number of queued requests per "scheme://host:port"
+        QHash<QString, int> queuedRequests() const;
         void setProxy(QString host, int port, const QString username = QString(), const QString password = QString());
 
+        //! returns the URL the tile paths of a host are appended to
+        /*!
+         * @param host the host, optionally with scheme, port and path prefix
+         * @return the URL as "scheme://host:port/prefix"
+         */
+        static QString hostBaseUrl(const QString& host);
+
+        //! returns the User-Agent header sent with the tile requests
+        /*!
+         * Tile servers ask to identify the application, so the User-Agent starts with the
+         * QCoreApplication::applicationName() and applicationVersion(), followed by "QMapControl".
+         */
+        static QByteArray userAgent();
+
         /*!
         *
-        * @return number of elements in the load queue
+        * @return number of elements in the load queue, without prefetched tiles
         */
         int loadQueueSize() const;
 
@@ -86,20 +194,93 @@ namespace qmapcontrol
          */
         void setDiskCache( QNetworkDiskCache* qCache );
 
+        //! returns the decoder which turns the downloaded data into images
+        TileDecoder* decoder() const;
+
+        //! called by the TileDecoder when the image of a tile is decoded
+        /*!
+         * @param tile the key of the tile
+         * @param image the decoded image, a null image if the data could not be decoded
+         */
+        void tileDecoded(const TileKey& tile, const QImage& image);
+
     private:
         Q_DISABLE_COPY (MapNetwork)
 
+        struct LoadingTile
+        {
+            TileKey tile;
+            QString url;
+            QString hostKey;
+            QNetworkRequest request;
+            QNetworkReply* reply; // 0 while the tile is queued or decoded
+            bool decoding;
+            bool prefetch;
+            bool fromCache; // the request only reads the disk cache
+            bool stale; // the cached tile expired and is revalidated once it is shown
+            bool revalidate; // the request checks if the shown tile changed
+            QByteArray cachedDigest; // SHA-1 of the cached data, to detect unchanged tiles
+        };
+
+        struct HostState
+        {
+            HostState() : failures(0), openings(0), retryAt(0), open(false)
+            {
+            }
+
+            int failures; // failed requests in a row
+            int openings; // failed probes in a row, for the delay
+            qint64 retryAt; // msecs since epoch
+            bool open; // the host is not requested
+        };
+
+        struct TileViewport
+        {
+            int zoom;
+            int zoomDirection; // -1 for MapAdapters with a reversed zoom
+            int tilesize;
+            QRect viewport;
+            QPoint middle;
+            QRect prefetchArea;
+        };
+
+        QString baseUrl(const QString& host);
+        void scheduleRequests();
+        void cancelTiles(const QList<TileKey>& tiles);
+        void tileFinished(bool prefetched);
+        int updateHostState(const QString& hostKey, bool responded);
+        bool isHostBlocked(const QString& hostKey, int running, qint64 now) const;
+        void parkTile(const TileKey& tile);
+        void unparkTiles(const QString& hostKey, int count = -1);
+        bool isInViewport(const LoadingTile& loading) const;
+        bool isInPrefetchArea(const LoadingTile& loading) const;
+        qint64 distanceToMiddle(const LoadingTile& loading) const;
+
         ImageManager* parent;
         QNetworkAccessManager* http;
-        QList<QNetworkReply*> replyList;
-        QMap<QString, QString> loadingMap;
+        TileDecoder* tileDecoder;
+        // both directions of the in-flight index, so lookup and completion never scan
+        QHash<TileKey, LoadingTile> loadingTiles;
+        QHash<QNetworkReply*, TileKey> loadingReplies;
+        QHash<TileKey, LoadingTile> parkedTiles; // queued tiles of hosts which are not requested, not counted as loading
+        QHash<QString, int> runningPerHost;
+        QHash<QString, HostState> hostStates;
+        QHash<const MapAdapter*, TileViewport> viewports;
+        QHash<QString, QString> hostUrls; // "scheme://host:port/prefix" of each host, parsed once
+        int maxPerHost;
+        int prefetching;
+        int revalidating;
+        bool requestsScheduled;
         qreal loaded;
         mutable QMutex vectorMutex;
         bool    networkActive;
         bool    cacheEnabled;
+        bool    http2Allowed;
+        bool    staleWhileRevalidate;
 
     private slots:
         void requestFinished(QNetworkReply *reply);
+        void startRequests();
     };
 }
 #endif
@@ -29,6 +29,7 @@ namespace qmapcontrol
     OpenAerialMapAdapter::OpenAerialMapAdapter()
             : TileMapAdapter("tile.openaerialmap.org", "/tiles/1.0.0/openaerialmap-900913/%1/%2/%3.png", 256, 0, 17)
     {
+        setProjectionInherited();
     }
 
     OpenAerialMapAdapter::~OpenAerialMapAdapter()
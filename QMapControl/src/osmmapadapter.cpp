@@ -27,8 +27,9 @@
 namespace qmapcontrol
 {
     OSMMapAdapter::OSMMapAdapter()
-            : TileMapAdapter("tile.openstreetmap.org", "/%1/%2/%3.png", 256, 0, 17)
+            : TileMapAdapter("https://tile.openstreetmap.org", "/%1/%2/%3.png", 256, 0, 17)
     {
+        setProjectionInherited();
     }
 
     OSMMapAdapter::~OSMMapAdapter()
@@ -27,9 +27,10 @@
 namespace qmapcontrol
 {
     Point::Point()
+            : projectedAdapter(0), projectedZoom(0)
     {}
     Point::Point(const Point& point)
-            :Geometry(point.name()), X(point.longitude()), Y(point.latitude())
+            :Geometry(point.name()), X(point.longitude()), Y(point.latitude()), projectedAdapter(0), projectedZoom(0)
     {
         visible = point.isVisible();
         mywidget = 0;
@@ -41,7 +42,7 @@ namespace qmapcontrol
     }
 
     Point::Point(qreal x, qreal y, QString name, enum Alignment alignment)
-            : Geometry(name), X(x), Y(y), myalignment(alignment)
+            : Geometry(name), X(x), Y(y), myalignment(alignment), projectedAdapter(0), projectedZoom(0)
     {
         GeometryType = "Point";
         mywidget = 0;
@@ -53,7 +54,7 @@ namespace qmapcontrol
     }
 
     Point::Point(qreal x, qreal y, QWidget* widget, QString name, enum Alignment alignment)
-            : Geometry(name), X(x), Y(y), mywidget(widget), myalignment(alignment)
+            : Geometry(name), X(x), Y(y), mywidget(widget), myalignment(alignment), projectedAdapter(0), projectedZoom(0)
     {
         // Point(x, y, name, alignment);
         GeometryType = "Point";
@@ -63,6 +64,8 @@ namespace qmapcontrol
         homelevel = -1;
         minsize = QSize(-1,-1);
         maxsize = QSize(-1,-1);
+        // widgets are moved on each paint, they can't be drawn into a cached image
+        setDynamic(true);
 
         if(mywidget!=0)
         {
@@ -70,7 +73,7 @@ namespace qmapcontrol
         }
     }
     Point::Point(qreal x, qreal y, QPixmap pixmap, QString name, enum Alignment alignment)
-            : Geometry(name), X(x), Y(y), mypixmap(pixmap), myalignment(alignment)
+            : Geometry(name), X(x), Y(y), mypixmap(pixmap), myalignment(alignment), projectedAdapter(0), projectedZoom(0)
     {
         GeometryType = "Point";
         mywidget = 0;
@@ -111,11 +114,13 @@ namespace qmapcontrol
 
     void Point::setPixmap( QPixmap qPixmap )
     {
+        emit(updateRequest(this));
         mypixmap = qPixmap;
         size = mypixmap.size();
+        displaysize = size;
 
         //forces redraw
-        emit(updateRequest(QRectF(X, Y, size.width(), size.height())));
+        emit(updateRequest(this));
         emit(positionChanged(this));
     }
 
@@ -126,6 +131,7 @@ namespace qmapcontrol
         {
             mywidget->setVisible(visible);
         }
+        emit(updateRequest(this));
     }
 
     QRectF Point::boundingBox()
@@ -148,24 +154,22 @@ namespace qmapcontrol
         return QRectF(min, si);
     }
 
-    qreal Point::longitude() const
-    {
-        return X;
-    }
-    qreal Point::latitude() const
-    {
-        return Y;
-    }
-    QPointF Point::coordinate() const
+    QRect Point::displayBoundingBox(const MapAdapter* mapadapter)
     {
-        return QPointF(X, Y);
+        updateDisplaySize(mapadapter);
+
+        const QPoint point = displayPosition(mapadapter);
+        QRect rect = displaysize.isValid() ? QRect(alignedPoint(point), displaysize) : QRect();
+
+        // Touches() accepts clicks around the coordinate, whatever the alignment is
+        const int halfwidth = mypixmap.width() > 0 ? (mypixmap.width()+1)/2 : 2;
+        rect |= QRect(point - QPoint(halfwidth, halfwidth), point + QPoint(halfwidth, halfwidth));
+
+        return rect.adjusted(-1, -1, 1, 1);
     }
 
-    void Point::draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &viewport, const QPoint offset)
+    void Point::updateDisplaySize(const MapAdapter* mapadapter)
     {
-        if (!visible)
-            return;
-
         if (homelevel > 0)
         {
 
@@ -195,16 +199,35 @@ namespace qmapcontrol
         {
             displaysize = size;
         }
+    }
 
+    qreal Point::longitude() const
+    {
+        return X;
+    }
+    qreal Point::latitude() const
+    {
+        return Y;
+    }
+    QPointF Point::coordinate() const
+    {
+        return QPointF(X, Y);
+    }
+
+    void Point::draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &viewport, const QPoint offset)
+    {
+        if (!visible)
+            return;
+
+        updateDisplaySize(mapadapter);
 
         if (mypixmap.size().width() > 0)
         {
-            const QPointF c = QPointF(X, Y);
-            QPoint point = mapadapter->coordinateToDisplay(c);
+            QPoint point = displayPosition(mapadapter);
 
-            if (viewport.contains(point))
+            QPoint alignedtopleft = alignedPoint(point);
+            if (viewport.intersects(QRect(alignedtopleft, displaysize)))
             {
-                QPoint alignedtopleft = alignedPoint(point);
                 painter->drawPixmap(alignedtopleft.x(), alignedtopleft.y(), displaysize.width(), displaysize.height(), mypixmap);
             }
 
@@ -216,10 +239,29 @@ namespace qmapcontrol
 
     }
 
+    QPoint Point::displayPosition(const MapAdapter* mapadapter)
+    {
+        // pixmaps and widgets stay on whole pixels, like MapAdapter::coordinateToDisplay()
+        const QPointF point = displayPositionF(mapadapter);
+        return QPoint(int(point.x()), int(point.y()));
+    }
+
+    QPointF Point::displayPositionF(const MapAdapter* mapadapter)
+    {
+        // the projection only changes with the zoom, panning just moves the painter
+        const int zoom = mapadapter->currentZoom();
+        if (projectedAdapter != mapadapter || projectedZoom != zoom)
+        {
+            projected = mapadapter->coordinateToDisplayF(QPointF(X, Y));
+            projectedAdapter = mapadapter;
+            projectedZoom = zoom;
+        }
+        return projected;
+    }
+
     void Point::drawWidget(const MapAdapter* mapadapter, const QPoint offset)
     {
-        const QPointF c = QPointF(X, Y);
-        QPoint point = mapadapter->coordinateToDisplay(c);
+        QPoint point = displayPosition(mapadapter);
         point -= offset;
 
         QPoint alignedtopleft = alignedPoint(point);
@@ -291,13 +333,13 @@ namespace qmapcontrol
             halfwidth = static_cast<qreal> (mypixmap.width()) / static_cast<qreal> (2);
         }
 
-        QPointF pt1 = mapadapter->coordinateToDisplay(coordinate());
+        QPointF pt1 = displayPosition(mapadapter);
         qreal pt1x1 = pt1.x() - halfwidth;
         qreal pt1x2 = pt1.x() + halfwidth;
         qreal pt1y1 = pt1.y() - halfwidth;
         qreal pt1y2 = pt1.y() + halfwidth;
 
-        QPointF pt2 = mapadapter->coordinateToDisplay(coordinate());
+        QPointF pt2 = displayPosition(mapadapter);
         qreal pt2x1 = pt2.x() - halfwidth;
         qreal pt2x2 = pt2.x() + halfwidth;
         qreal pt2y1 = pt2.y() - halfwidth;
@@ -329,10 +371,14 @@ namespace qmapcontrol
             return;
         }
 
+        // the old and the new place have to be redrawn
+        emit(updateRequest(this));
+
         X = point.x();
         Y = point.y();
+        projectedAdapter = 0;
         
-        emit(updateRequest(QRectF(X, Y, size.width(), size.height())));
+        emit(updateRequest(this));
         emit(positionChanged(this));
     }
     QList<Point*> Point::points()
@@ -129,6 +129,7 @@ namespace qmapcontrol
          * @return the bounding box of the point
          */
         virtual QRectF boundingBox();
+        virtual QRect displayBoundingBox(const MapAdapter* mapadapter);
 
         //! returns the longitude of the point
         /*!
@@ -205,11 +206,18 @@ namespace qmapcontrol
         QSize minsize;
         QSize maxsize;
 
+        // the display coordinate, projected once for each zoom level
+        const MapAdapter* projectedAdapter;
+        int projectedZoom;
+        QPointF projected;
 
+        QPoint displayPosition(const MapAdapter* mapadapter);
+        QPointF displayPositionF(const MapAdapter* mapadapter);
         void drawWidget(const MapAdapter* mapadapter, const QPoint offset);
         // void drawPixmap(QPainter* painter, const MapAdapter* mapadapter, const QRect &viewport, const QPoint versch);
         virtual void draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &viewport, const QPoint offset);
         QPoint alignedPoint(const QPoint point) const;
+        void updateDisplaySize(const MapAdapter* mapadapter);
 
         //! returns true if the given Point touches this Point
         /*!
@@ -0,0 +1,333 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+
+#include "polyline.h"
+
+namespace
+{
+    // grows a rect, whose top left is the minimum and bottom right the maximum, by the given points
+    QRectF extend(QRectF rect, bool empty, const QPointF* points, int count)
+    {
+        if (count == 0)
+        {
+            return rect;
+        }
+
+        qreal minx = empty ? points[0].x() : rect.left();
+        qreal maxx = empty ? points[0].x() : rect.right();
+        qreal miny = empty ? points[0].y() : rect.top();
+        qreal maxy = empty ? points[0].y() : rect.bottom();
+        for (int i=0; i<count; ++i)
+        {
+            minx = qMin(minx, points[i].x());
+            maxx = qMax(maxx, points[i].x());
+            miny = qMin(miny, points[i].y());
+            maxy = qMax(maxy, points[i].y());
+        }
+        return QRectF(QPointF(minx, miny), QPointF(maxx, maxy));
+    }
+}
+
+namespace qmapcontrol
+{
+    Polyline::Polyline(QString name, QPen* pen)
+            : Curve(name), projectedAdapter(0), projectedZoom(0), lodAdapter(0)
+    {
+        GeometryType = "Polyline";
+        mypen = pen;
+    }
+
+    Polyline::Polyline(const QVector<QPointF>& coordinates, QString name, QPen* pen)
+            : Curve(name), projectedAdapter(0), projectedZoom(0), lodAdapter(0)
+    {
+        GeometryType = "Polyline";
+        mypen = pen;
+        coords = coordinates;
+        box = extend(QRectF(), true, coords.constData(), coords.size());
+    }
+
+    Polyline::~Polyline()
+    {
+        removePoints();
+    }
+
+    void Polyline::addCoordinate(const QPointF& coordinate)
+    {
+        addCoordinates(QVector<QPointF>() << coordinate);
+    }
+
+    void Polyline::addCoordinates(const QVector<QPointF>& coordinates)
+    {
+        if (coordinates.isEmpty())
+        {
+            return;
+        }
+
+        box = extend(box, coords.isEmpty(), coordinates.constData(), coordinates.size());
+        coords += coordinates;
+
+        // the cached display coordinates and levels of detail are kept, only the new ones are added
+        removePoints();
+
+        // the line only grows, so its new area covers the old one
+        emit(updateRequest(this));
+    }
+
+    void Polyline::setCoordinates(const QVector<QPointF>& coordinates)
+    {
+        emit(updateRequest(this));
+        coords = coordinates;
+        box = extend(QRectF(), true, coords.constData(), coords.size());
+        resetCache();
+        removePoints();
+        emit(updateRequest(this));
+    }
+
+    void Polyline::clear()
+    {
+        setCoordinates(QVector<QPointF>());
+    }
+
+    QVector<QPointF> Polyline::coordinates() const
+    {
+        return coords;
+    }
+
+    QVector<QPointF> Polyline::coordinates(int from, int count) const
+    {
+        return coords.mid(from, count);
+    }
+
+    QPointF Polyline::coordinate(int index) const
+    {
+        return coords.at(index);
+    }
+
+    int Polyline::numberOfPoints() const
+    {
+        return coords.size();
+    }
+
+    QList<Point*> Polyline::points()
+    {
+        QList<Point*> points;
+        for (int i=0; i<coords.size(); ++i)
+        {
+            points.append(pointAt(i));
+        }
+        return points;
+    }
+
+    Point* Polyline::pointAt(int index)
+    {
+        Point* point = childPoints.value(index);
+        if (point == 0)
+        {
+            point = new Point(coords.at(index).x(), coords.at(index).y());
+            point->setParentGeometry(this);
+            childPoints.insert(index, point);
+        }
+        return point;
+    }
+
+    void Polyline::removePoints()
+    {
+        touchedPoints.clear();
+        qDeleteAll(childPoints);
+        childPoints.clear();
+    }
+
+    void Polyline::resetCache()
+    {
+        projectedAdapter = 0;
+        projected.clear();
+        lods.clear();
+    }
+
+    void Polyline::project(const MapAdapter* mapadapter)
+    {
+        const int zoom = mapadapter->currentZoom();
+        const int first = projectedAdapter == mapadapter && projectedZoom == zoom ? projected.size() : 0;
+        if (first == coords.size())
+        {
+            return;
+        }
+
+        // coordinates which were added since the last call are projected on their own
+        projected.resize(coords.size());
+        mapadapter->coordinatesToDisplayF(coords.constData() + first, projected.data() + first, coords.size() - first);
+        projectedBox = extend(projectedBox, first == 0, projected.constData() + first, coords.size() - first);
+        projectedAdapter = mapadapter;
+        projectedZoom = zoom;
+    }
+
+    QVector<int> Polyline::levelOfDetail(const MapAdapter* mapadapter)
+    {
+        if (lodAdapter != mapadapter)
+        {
+            lods.clear();
+            lodAdapter = mapadapter;
+        }
+
+        // appended coordinates are simplified together with the last segment of the line, so the old end
+        // point can be left out; the points before it are kept
+        const int zoom = mapadapter->currentZoom();
+        QVector<int>& lod = lods[zoom];
+        if (lod.isEmpty())
+        {
+            lod = simplify(projected);
+        }
+        else if (lod.last() < projected.size()-1)
+        {
+            const int from = lod.at(lod.size()-2);
+            lod.resize(lod.size()-2);
+            lod += simplify(projected, from);
+        }
+        return lod;
+    }
+
+    QRectF Polyline::boundingBox()
+    {
+        if (coords.isEmpty())
+        {
+            // inverted like the box of a LineString without points, so it doesn't extend the box of the layer
+            return QRectF(QPointF(180, 90), QPointF(-180, -90));
+        }
+        return box;
+    }
+
+    QRect Polyline::displayBoundingBox(const MapAdapter* mapadapter)
+    {
+        if (coords.isEmpty())
+        {
+            return QRect();
+        }
+
+        project(mapadapter);
+        // the line is drawn with the fractions of the pixels, which reach into the next one
+        const int margin = penMargin();
+        return projectedBox.toAlignedRect().adjusted(-margin, -margin, margin+1, margin+1);
+    }
+
+    bool Polyline::hasPoints() const
+    {
+        return !coords.isEmpty();
+    }
+
+    bool Polyline::hasClickedPoints() const
+    {
+        return !touchedPoints.isEmpty();
+    }
+
+    void Polyline::draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &screensize, const QPoint /*offset*/)
+    {
+        if (!visible || coords.size() < 2)
+            return;
+
+        project(mapadapter);
+        const int margin = penMargin();
+        const QRectF clip = screensize.adjusted(-margin, -margin, margin, margin);
+        if (!clip.intersects(projectedBox.adjusted(0, 0, 1, 1)))
+        {
+            return;
+        }
+
+        if (mypen != 0)
+        {
+            painter->save();
+            painter->setPen(*mypen);
+        }
+
+        // long lines are drawn with the points which are visible at this zoom
+        const QVector<int> lod = levelOfDetail(mapadapter);
+        if (lod.isEmpty())
+        {
+            drawClipped(painter, clip, projected);
+        }
+        else
+        {
+            QVector<QPointF> line(lod.size());
+            for (int i=0; i<lod.size(); ++i)
+            {
+                line[i] = projected.at(lod.at(i));
+            }
+            drawClipped(painter, clip, line);
+        }
+
+        if (mypen != 0)
+        {
+            painter->restore();
+        }
+    }
+
+    bool Polyline::Touches(Point* geom, const MapAdapter* mapadapter)
+    {
+        touchedPoints.clear();
+        if (!visible || coords.size() < 2)
+        {
+            return false;
+        }
+
+        project(mapadapter);
+        const QPointF click = mapadapter->coordinateToDisplayF(geom->coordinate());
+
+        qreal halfwidth = 2; // use 2 pixels by default
+        if (mypen && mypen->width() > 0)
+        {
+            halfwidth = mypen->widthF() / 2;
+        }
+        if (!projectedBox.adjusted(-halfwidth, -halfwidth, halfwidth, halfwidth).contains(click))
+        {
+            return false;
+        }
+
+        // the distance to each segment, the points are only created if the line is touched
+        bool touches = false;
+        for (int i=1; i<projected.size(); ++i)
+        {
+            const QPointF a = projected.at(i-1);
+            const qreal dx = projected.at(i).x() - a.x();
+            const qreal dy = projected.at(i).y() - a.y();
+            const qreal px = click.x() - a.x();
+            const qreal py = click.y() - a.y();
+            const qreal length = dx*dx + dy*dy;
+            const qreal t = length > 0 ? qBound(qreal(0), (px*dx + py*dy) / length, qreal(1)) : 0;
+            const qreal ex = px - t*dx;
+            const qreal ey = py - t*dy;
+            if (ex*ex + ey*ey <= halfwidth*halfwidth)
+            {
+                touchedPoints.append(pointAt(i));
+                touches = true;
+            }
+        }
+
+        if (touches)
+        {
+            emit(geometryClicked(this, QPoint(0,0)));
+        }
+        return touches;
+    }
+}
@@ -0,0 +1,154 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+
+#ifndef POLYLINE_H
+#define POLYLINE_H
+
+#include "qmapcontrol_global.h"
+#include "curve.h"
+#include <QHash>
+#include <QVector>
+
+namespace qmapcontrol
+{
+    //! A line which stores its coordinates instead of Point objects
+    /*!
+     * A Polyline is drawn like a LineString, but keeps its coordinates in one contiguous array.
+     * It is meant for long tracks, which are appended to frequently and whose single points are neither
+     * styled nor clicked: adding a coordinate doesn't create a QObject and the whole line is projected
+     * with one call to the MapAdapter.
+     *
+     * Point objects are only created when points() is called, or for the clicked points of the line.
+     * They are owned by the Polyline and deleted when its coordinates change, so they can't be used
+     * to move the coordinates of the line.
+     * @see LineString
+     */
+    class QMAPCONTROL_EXPORT Polyline : public Curve
+    {
+        Q_OBJECT
+
+    public:
+        //! constructor
+        /*!
+         * @param name the name of the Polyline
+         * @param pen a QPen can be used to modify the look of the line.
+         */
+        Polyline(QString name = QString(), QPen* pen = 0);
+
+        //! constructor
+        /*!
+         * @param coordinates the coordinates of the line, as longitude (x) and latitude (y)
+         * @param name the name of the Polyline
+         * @param pen a QPen can be used to modify the look of the line.
+         */
+        Polyline(const QVector<QPointF>& coordinates, QString name = QString(), QPen* pen = 0);
+        virtual ~Polyline();
+
+        //! adds a coordinate at the end of the line
+        /*!
+         * @param coordinate the coordinate, as longitude (x) and latitude (y)
+         */
+        void addCoordinate(const QPointF& coordinate);
+
+        //! adds coordinates at the end of the line
+        /*!
+         * @param coordinates the coordinates, as longitude (x) and latitude (y)
+         */
+        void addCoordinates(const QVector<QPointF>& coordinates);
+
+        //! replaces the coordinates of the line
+        /*!
+         * @param coordinates the coordinates, as longitude (x) and latitude (y)
+         */
+        void setCoordinates(const QVector<QPointF>& coordinates);
+
+        //! returns all coordinates of the line
+        QVector<QPointF> coordinates() const;
+
+        //! returns a range of the coordinates
+        /*!
+         * @param from the index of the first coordinate
+         * @param count the number of coordinates, -1 for all up to the end of the line
+         * @return the coordinates, fewer if the range reaches beyond the end of the line
+         */
+        QVector<QPointF> coordinates(int from, int count = -1) const;
+
+        //! returns the coordinate at the given index
+        QPointF coordinate(int index) const;
+
+        //! returns the number of coordinates of the line
+        int numberOfPoints() const;
+
+        //! removes all coordinates
+        void clear();
+
+        //! returns the points of the line
+        /*!
+         * The points are created on the first call and remain valid until the coordinates change.
+         * @return  a list with the points of the line
+         */
+        virtual QList<Point*> points();
+
+        //! returns the bounding box (rect) that contains all coordinates
+        /*!
+         * @return the rect that contains all coordinates
+         */
+        virtual QRectF boundingBox();
+        virtual QRect displayBoundingBox(const MapAdapter* mapadapter);
+        virtual bool hasPoints() const;
+        virtual bool hasClickedPoints() const;
+
+    protected:
+        virtual bool Touches(Point* geom, const MapAdapter* mapadapter);
+        virtual void draw(QPainter* painter, const MapAdapter* mapadapter, const QRect &screensize, const QPoint offset);
+
+    private:
+        Q_DISABLE_COPY( Polyline )
+
+        Point* pointAt(int index);
+        void project(const MapAdapter* mapadapter);
+        QVector<int> levelOfDetail(const MapAdapter* mapadapter);
+        void removePoints();
+        void resetCache();
+
+        QVector<QPointF> coords;
+        QRectF box;
+
+        // the coordinates in display coordinates of projectedZoom
+        const MapAdapter* projectedAdapter;
+        int projectedZoom;
+        QVector<QPointF> projected;
+        QRectF projectedBox;
+
+        // the points which are drawn at a zoom level, built on first use
+        const MapAdapter* lodAdapter;
+        QHash<int, QVector<int> > lods;
+
+        // the points which were created, by their index
+        QHash<int, Point*> childPoints;
+    };
+}
+#endif
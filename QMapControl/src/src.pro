@@ -15,6 +15,7 @@ DESTDIR = ../Samples/bin
 
 HEADERS += curve.h \
            geometry.h \
+           geometryindex.h \
            imagemanager.h \
            layer.h \
            layermanager.h \
@@ -23,6 +24,7 @@ HEADERS += curve.h \
            mapcontrol.h \
            mapnetwork.h \
            point.h \
+           polyline.h \
            tilemapadapter.h \
            wmsmapadapter.h \
            circlepoint.h \
@@ -39,10 +41,18 @@ HEADERS += curve.h \
            invisiblepoint.h \
            qmapcontrol_global.h \
            bingapimapadapter.h \
-           googleapimapadapter.h
+           googleapimapadapter.h \
+           tilekey.h \
+           tiledecoder.h \
+           tilecache.h \
+           tilepack.h \
+           tilepackwriter.h \
+           tilepackmapadapter.h \
+           tileseeder.h
 
 SOURCES += curve.cpp \
            geometry.cpp \
+           geometryindex.cpp \
            imagemanager.cpp \
            layer.cpp \
            layermanager.cpp \
@@ -51,6 +61,7 @@ SOURCES += curve.cpp \
            mapcontrol.cpp \
            mapnetwork.cpp \
            point.cpp \
+           polyline.cpp \
            tilemapadapter.cpp \
            wmsmapadapter.cpp \
            circlepoint.cpp \
@@ -66,4 +77,10 @@ SOURCES += curve.cpp \
            invisiblepoint.cpp \
            emptymapadapter.cpp \
            bingapimapadapter.cpp \
-           googleapimapadapter.cpp
+           googleapimapadapter.cpp \
+           tiledecoder.cpp \
+           tilecache.cpp \
+           tilepack.cpp \
+           tilepackwriter.cpp \
+           tilepackmapadapter.cpp \
+           tileseeder.cpp
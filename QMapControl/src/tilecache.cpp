@@ -0,0 +1,299 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "tilecache.h"
+#include "mapadapter.h"
+
+static const qint64 kDefaultTileCacheBytes = Q_INT64_C(64)*1024*1024;
+
+namespace qmapcontrol
+{
+    TileCache::TileCache()
+        :   first(0),
+            last(0),
+            totalBytes(0),
+            budget(kDefaultTileCacheBytes),
+            hitCount(0),
+            missCount(0),
+            evictionCount(0)
+    {
+    }
+
+    TileCache::~TileCache()
+    {
+        clear();
+    }
+
+    bool TileCache::find(const TileKey& tile, QPixmap* pixmap)
+    {
+        QHash<TileKey, Entry*>::const_iterator it = entries.constFind(tile);
+        if (it == entries.constEnd())
+        {
+            ++missCount;
+            return false;
+        }
+
+        Entry* entry = it.value();
+        if (entry != first)
+        {
+            unlink(entry);
+            link(entry);
+        }
+
+        ++hitCount;
+        *pixmap = entry->pixmap;
+        return true;
+    }
+
+    bool TileCache::contains(const TileKey& tile) const
+    {
+        return entries.contains(tile);
+    }
+
+    bool TileCache::peek(const TileKey& tile, QPixmap* pixmap) const
+    {
+        QHash<TileKey, Entry*>::const_iterator it = entries.constFind(tile);
+        if (it == entries.constEnd())
+        {
+            return false;
+        }
+
+        *pixmap = it.value()->pixmap;
+        return true;
+    }
+
+    void TileCache::insert(const TileKey& tile, const QPixmap& pixmap)
+    {
+        QHash<TileKey, Entry*>::iterator it = entries.find(tile);
+        if (it != entries.end())
+        {
+            drop(it.value());
+        }
+
+        Entry* entry = new Entry;
+        entry->tile = tile;
+        entry->pixmap = pixmap;
+        entry->cost = qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+        link(entry);
+        entries.insert(tile, entry);
+
+        Partition& partition = partitions[tile.adapter];
+        partition.bytes += entry->cost;
+        totalBytes += entry->cost;
+
+        if (partition.quota > 0 && partition.bytes > partition.quota)
+        {
+            evict(tile.adapter, partition.quota);
+        }
+        if (totalBytes > budget)
+        {
+            evict(0, budget);
+        }
+    }
+
+    void TileCache::remove(const QObject* adapter)
+    {
+        Entry* entry = last;
+        while (entry)
+        {
+            Entry* previous = entry->previous;
+            if (static_cast<const QObject*>(entry->tile.adapter) == adapter)
+            {
+                drop(entry);
+            }
+            entry = previous;
+        }
+
+        QMutableHashIterator<const MapAdapter*, Partition> it(partitions);
+        while (it.hasNext())
+        {
+            if (static_cast<const QObject*>(it.next().key()) == adapter)
+            {
+                it.remove();
+            }
+        }
+    }
+
+    void TileCache::clear()
+    {
+        while (first)
+        {
+            drop(first);
+        }
+    }
+
+    void TileCache::setMaxBytes(qint64 bytes)
+    {
+        budget = qMax(Q_INT64_C(0), bytes);
+        evict(0, budget);
+    }
+
+    qint64 TileCache::maxBytes() const
+    {
+        return budget;
+    }
+
+    void TileCache::setQuota(const MapAdapter* adapter, qint64 bytes)
+    {
+        Partition& partition = partitions[adapter];
+        partition.quota = qMax(Q_INT64_C(0), bytes);
+        if (partition.quota > 0)
+        {
+            evict(adapter, partition.quota);
+        }
+    }
+
+    qint64 TileCache::quota(const MapAdapter* adapter) const
+    {
+        return partitions.value(adapter).quota;
+    }
+
+    void TileCache::pin(const MapAdapter* adapter, int zoom, int tilesize, const QRect& area)
+    {
+        Partition& partition = partitions[adapter];
+        partition.zoom = zoom;
+        if (area.isEmpty() || tilesize <= 0)
+        {
+            partition.pinned = QRect();
+        }
+        else
+        {
+            partition.pinned = QRect(QPoint(tileIndex(area.left(), tilesize), tileIndex(area.top(), tilesize)),
+                                     QPoint(tileIndex(area.right(), tilesize), tileIndex(area.bottom(), tilesize)));
+        }
+    }
+
+    qint64 TileCache::bytes() const
+    {
+        return totalBytes;
+    }
+
+    qint64 TileCache::bytes(const MapAdapter* adapter) const
+    {
+        return partitions.value(adapter).bytes;
+    }
+
+    int TileCache::count() const
+    {
+        return entries.size();
+    }
+
+    quint64 TileCache::hits() const
+    {
+        return hitCount;
+    }
+
+    quint64 TileCache::misses() const
+    {
+        return missCount;
+    }
+
+    quint64 TileCache::evictions() const
+    {
+        return evictionCount;
+    }
+
+    void TileCache::resetStatistics()
+    {
+        hitCount = 0;
+        missCount = 0;
+        evictionCount = 0;
+    }
+
+    bool TileCache::isPinned(const Entry* entry) const
+    {
+        QHash<const MapAdapter*, Partition>::const_iterator it = partitions.constFind(entry->tile.adapter);
+        // tiles of a previous server are never drawn again
+        return it != partitions.constEnd() && it->zoom == entry->tile.z &&
+               it->pinned.contains(entry->tile.x, entry->tile.y) &&
+               entry->tile.generation == entry->tile.adapter->tileGeneration();
+    }
+
+    void TileCache::link(Entry* entry)
+    {
+        entry->previous = 0;
+        entry->next = first;
+        if (first)
+        {
+            first->previous = entry;
+        }
+        first = entry;
+        if (!last)
+        {
+            last = entry;
+        }
+    }
+
+    void TileCache::unlink(Entry* entry)
+    {
+        if (entry->previous)
+        {
+            entry->previous->next = entry->next;
+        }
+        else
+        {
+            first = entry->next;
+        }
+
+        if (entry->next)
+        {
+            entry->next->previous = entry->previous;
+        }
+        else
+        {
+            last = entry->previous;
+        }
+    }
+
+    void TileCache::drop(Entry* entry)
+    {
+        unlink(entry);
+        entries.remove(entry->tile);
+
+        QHash<const MapAdapter*, Partition>::iterator it = partitions.find(entry->tile.adapter);
+        if (it != partitions.end())
+        {
+            it->bytes -= entry->cost;
+        }
+        totalBytes -= entry->cost;
+        delete entry;
+    }
+
+    void TileCache::evict(const MapAdapter* adapter, qint64 maxBytes)
+    {
+        // the least recently used tiles go first, 0 as adapter evicts from all of them
+        Entry* entry = last;
+        while (entry && (adapter ? bytes(adapter) : totalBytes) > maxBytes)
+        {
+            Entry* previous = entry->previous;
+            if ((!adapter || entry->tile.adapter == adapter) && !isPinned(entry))
+            {
+                drop(entry);
+                ++evictionCount;
+            }
+            entry = previous;
+        }
+    }
+}
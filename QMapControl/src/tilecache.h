@@ -0,0 +1,179 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include "qmapcontrol_global.h"
+#include <QObject>
+#include <QPixmap>
+#include <QHash>
+#include <QRect>
+#include "tilekey.h"
+
+namespace qmapcontrol
+{
+    //! Keeps decoded tiles in memory
+    /*!
+     * The cache holds the tiles of all MapAdapters up to a budget in bytes.
+     * When the budget is exceeded the least recently used tiles are dropped.
+     * Each MapAdapter, i.e. each map layer, can be limited further by a quota.
+     *
+     * Tiles within the pinned area of a MapAdapter, usually its offscreen viewport,
+     * are never dropped, so the visible map does not need to be loaded again.
+     * If the pinned tiles alone exceed the budget, the cache grows beyond it.
+     */
+    class QMAPCONTROL_EXPORT TileCache
+    {
+    public:
+        TileCache();
+        ~TileCache();
+
+        //! looks up a tile
+        /*!
+         * A found tile becomes the most recently used one.
+         * @param tile the key of the tile
+         * @param pixmap receives the cached tile
+         * @return true if the tile was cached
+         */
+        bool find(const TileKey& tile, QPixmap* pixmap);
+
+        //! returns true if the tile is cached, without counting a hit or miss
+        bool contains(const TileKey& tile) const;
+
+        //! looks up a tile without counting a hit or miss and without changing the order of the tiles
+        /*!
+         * This is used for tiles which only stand in for a missing one.
+         * @param tile the key of the tile
+         * @param pixmap receives the cached tile
+         * @return true if the tile was cached
+         */
+        bool peek(const TileKey& tile, QPixmap* pixmap) const;
+
+        //! adds a tile, replacing a cached version of it
+        /*!
+         * @param tile the key of the tile
+         * @param pixmap the tile image, a null pixmap records a tile which could not be read
+         */
+        void insert(const TileKey& tile, const QPixmap& pixmap);
+
+        //! removes all tiles of a MapAdapter
+        /*!
+         * The adapter is only compared, so this can be called while it is destroyed.
+         * @param adapter the MapAdapter of the tiles
+         */
+        void remove(const QObject* adapter);
+
+        //! removes all tiles
+        void clear();
+
+        //! sets the memory budget of the cache
+        /*!
+         * @param bytes the maximum size of all tiles in bytes
+         */
+        void setMaxBytes(qint64 bytes);
+        qint64 maxBytes() const;
+
+        //! limits the memory used by the tiles of a MapAdapter
+        /*!
+         * @param adapter the MapAdapter of the tiles
+         * @param bytes the maximum size of its tiles in bytes, 0 to use the budget of the whole cache
+         */
+        void setQuota(const MapAdapter* adapter, qint64 bytes);
+        qint64 quota(const MapAdapter* adapter) const;
+
+        //! sets the tiles of a MapAdapter which must not be dropped
+        /*!
+         * A new area replaces the previous one of the MapAdapter.
+         * @param adapter the MapAdapter of the tiles
+         * @param zoom the zoom of the pinned tiles
+         * @param tilesize the tile size of the MapAdapter
+         * @param area the pinned area in display coordinates, an empty area pins nothing
+         */
+        void pin(const MapAdapter* adapter, int zoom, int tilesize, const QRect& area);
+
+        //! returns the size of all cached tiles in bytes
+        qint64 bytes() const;
+
+        //! returns the size of the cached tiles of a MapAdapter in bytes
+        qint64 bytes(const MapAdapter* adapter) const;
+
+        //! returns the number of cached tiles
+        int count() const;
+
+        //! returns how often find() found a tile
+        quint64 hits() const;
+
+        //! returns how often find() did not find a tile
+        quint64 misses() const;
+
+        //! returns how many tiles were dropped to stay within the budget or a quota
+        quint64 evictions() const;
+
+        //! sets the hit, miss and eviction counters to zero
+        void resetStatistics();
+
+    private:
+        Q_DISABLE_COPY (TileCache)
+
+        struct Entry
+        {
+            TileKey tile;
+            QPixmap pixmap;
+            qint64 cost;
+            Entry* previous; // more recently used
+            Entry* next; // less recently used
+        };
+
+        struct Partition
+        {
+            Partition() : bytes(0), quota(0), zoom(0)
+            {
+            }
+
+            qint64 bytes;
+            qint64 quota;
+            int zoom;
+            QRect pinned; // in tile coordinates
+        };
+
+        bool isPinned(const Entry* entry) const;
+        void link(Entry* entry);
+        void unlink(Entry* entry);
+        void drop(Entry* entry);
+        void evict(const MapAdapter* adapter, qint64 maxBytes);
+
+        QHash<TileKey, Entry*> entries;
+        QHash<const MapAdapter*, Partition> partitions;
+        Entry* first; // most recently used
+        Entry* last; // least recently used
+        qint64 totalBytes;
+        qint64 budget;
+        quint64 hitCount;
+        quint64 missCount;
+        quint64 evictionCount;
+    };
+}
+#endif
@@ -0,0 +1,146 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "tiledecoder.h"
+#include "mapnetwork.h"
+#include <QRunnable>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QThread>
+
+static const int kDefaultMaxPendingImages = 64;
+
+namespace
+{
+    class DecodeTask : public QRunnable
+    {
+    public:
+        DecodeTask(qmapcontrol::TileDecoder* decoder, int ticket, const QByteArray& data, bool convert)
+            : decoder(decoder), ticket(ticket), data(data), convert(convert)
+        {
+        }
+
+        void run()
+        {
+            QImage image;
+            if (!decoder->isAborted() && image.loadFromData(data) && convert)
+            {
+                image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                      : QImage::Format_RGB32);
+            }
+
+            // queued, so the result is handled in the thread of the decoder
+            QMetaObject::invokeMethod(decoder, "imageDecoded", Qt::QueuedConnection,
+                                      Q_ARG(int, ticket), Q_ARG(QImage, image));
+        }
+
+    private:
+        qmapcontrol::TileDecoder* decoder;
+        int ticket;
+        QByteArray data;
+        bool convert;
+    };
+}
+
+namespace qmapcontrol
+{
+    TileDecoder::TileDecoder(MapNetwork* parent)
+        :   parent(parent),
+            nextTicket(0),
+            maxPendingImages(kDefaultMaxPendingImages),
+            convertToPremultiplied(true),
+            aborted(false)
+    {
+        // leave one core to the GUI thread
+        pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    }
+
+    TileDecoder::~TileDecoder()
+    {
+        {
+            QMutexLocker lock(&abortMutex);
+            aborted = true;
+        }
+
+        // results which are posted meanwhile are discarded together with this object
+        pool.waitForDone();
+    }
+
+    void TileDecoder::decode(const TileKey& tile, const QByteArray& data)
+    {
+        const int ticket = nextTicket++;
+        pending.insert(ticket, tile);
+        pool.start(new DecodeTask(this, ticket, data, convertToPremultiplied));
+    }
+
+    void TileDecoder::imageDecoded(int ticket, QImage image)
+    {
+        QHash<int, TileKey>::iterator it = pending.find(ticket);
+        if (it == pending.end())
+        {
+            return;
+        }
+
+        const TileKey tile = it.value();
+        pending.erase(it);
+        parent->tileDecoded(tile, image);
+    }
+
+    int TileDecoder::pendingCount() const
+    {
+        return pending.size();
+    }
+
+    void TileDecoder::setMaxPending(int maxPending)
+    {
+        maxPendingImages = qMax(1, maxPending);
+    }
+
+    int TileDecoder::maxPending() const
+    {
+        return maxPendingImages;
+    }
+
+    void TileDecoder::setConvertToPremultiplied(bool convert)
+    {
+        convertToPremultiplied = convert;
+    }
+
+    void TileDecoder::setThreadCount(int threads)
+    {
+        pool.setMaxThreadCount(qMax(1, threads));
+    }
+
+    int TileDecoder::threadCount() const
+    {
+        return pool.maxThreadCount();
+    }
+
+    bool TileDecoder::isAborted() const
+    {
+        QMutexLocker lock(&abortMutex);
+        return aborted;
+    }
+}
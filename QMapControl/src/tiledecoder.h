@@ -0,0 +1,114 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILEDECODER_H
+#define TILEDECODER_H
+
+#include "qmapcontrol_global.h"
+#include <QObject>
+#include <QThreadPool>
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QHash>
+#include "tilekey.h"
+
+namespace qmapcontrol
+{
+    class MapNetwork;
+
+    //! Decodes downloaded tile images outside of the GUI thread
+    /*!
+     * The encoded tile data is decoded into a QImage by a pool of worker threads.
+     * Decoded images are handed back to the MapNetwork in the thread of the decoder,
+     * so the GUI thread only converts the finished image into a pixmap.
+     *
+     * The number of pending images is limited. The MapNetwork does not start new
+     * requests while the decoder is full, so decoding can never pile up behind panning.
+     */
+    class QMAPCONTROL_EXPORT TileDecoder : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        TileDecoder(MapNetwork* parent);
+        ~TileDecoder();
+
+        //! queues encoded image data for decoding
+        /*!
+         * The result is passed to MapNetwork::tileDecoded(). A null image is passed if the data could not be decoded.
+         * @param tile the key of the tile
+         * @param data the encoded image, e.g. PNG or JPEG
+         */
+        void decode(const TileKey& tile, const QByteArray& data);
+
+        //! returns the number of images which are queued or being decoded
+        int pendingCount() const;
+
+        //! sets how many images may be queued or decoded at the same time
+        /*!
+         * @param maxPending the number of pending images, default is 64
+         */
+        void setMaxPending(int maxPending);
+        int maxPending() const;
+
+        //! sets whether decoded images are converted to a premultiplied format
+        /*!
+         * Premultiplied images are painted without a further conversion, this work is moved to the worker threads.
+         * Images without an alpha channel are converted to RGB32. This is enabled by default.
+         * @param convert true to convert the decoded images
+         */
+        void setConvertToPremultiplied(bool convert);
+
+        //! sets the number of worker threads
+        /*!
+         * @param threads the number of worker threads, default is one less than the number of cores
+         */
+        void setThreadCount(int threads);
+        int threadCount() const;
+
+        //! returns true if the decoder is destroyed and queued images should be skipped
+        /*!
+         * This is called from the worker threads.
+         */
+        bool isAborted() const;
+
+    private:
+        Q_DISABLE_COPY (TileDecoder)
+
+        MapNetwork* parent;
+        QThreadPool pool;
+        QHash<int, TileKey> pending;
+        int nextTicket;
+        int maxPendingImages;
+        bool convertToPremultiplied;
+        mutable QMutex abortMutex;
+        bool aborted;
+
+    private slots:
+        void imageDecoded(int ticket, QImage image);
+    };
+}
+#endif
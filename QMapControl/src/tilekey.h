@@ -0,0 +1,96 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILEKEY_H
+#define TILEKEY_H
+
+#include "qmapcontrol_global.h"
+#include "mapadapter.h"
+#include <QHash>
+
+namespace qmapcontrol
+{
+    //! Identifies a single map tile
+    /*!
+     * A tile is identified by the MapAdapter which forms its query and by its
+     * x, y and zoom values as they are passed to the MapAdapter.
+     * The key is used to index tiles in hashes without building or comparing URL strings.
+     *
+     * The key also holds the MapAdapter::tileGeneration() at the time it is built, so tiles of a previous
+     * server are not found anymore after MapAdapter::changeHostAddress(). Apart from that the MapAdapter
+     * pointer is only used as an identity.
+     */
+    struct TileKey
+    {
+        TileKey()
+            : adapter(0), x(0), y(0), z(0), generation(0)
+        {
+        }
+
+        TileKey(const MapAdapter* adapter, int x, int y, int z)
+            : adapter(adapter), x(x), y(y), z(z), generation(adapter != 0 ? adapter->tileGeneration() : 0)
+        {
+        }
+
+        const MapAdapter* adapter;
+        int x;
+        int y;
+        int z;
+        int generation;
+    };
+
+    inline bool operator==(const TileKey& a, const TileKey& b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z && a.adapter == b.adapter && a.generation == b.generation;
+    }
+
+    inline bool operator!=(const TileKey& a, const TileKey& b)
+    {
+        return !(a == b);
+    }
+
+    inline uint qHash(const TileKey& key)
+    {
+        // x and y never exceed 2^zoom, so 24 bits each and 8 bits zoom keep the tile part unique
+        const quint64 tile = (quint64(quint32(key.z) & 0xff) << 48)
+                           | (quint64(quint32(key.x) & 0xffffff) << 24)
+                           | quint64(quint32(key.y) & 0xffffff);
+        const quint64 adapter = quint64(reinterpret_cast<quintptr>(key.adapter)) + quint64(key.generation);
+        return ::qHash(tile ^ (adapter * Q_UINT64_C(0x9E3779B97F4A7C15)));
+    }
+
+    //! returns the index of the tile which contains a display coordinate
+    /*!
+     * Unlike a plain division this also works for coordinates left or above of the map.
+     * @param px the display coordinate
+     * @param tilesize the tile size of the MapAdapter
+     * @return the tile index
+     */
+    inline int tileIndex(int px, int tilesize)
+    {
+        return px >= 0 ? px / tilesize : (px + 1) / tilesize - 1;
+    }
+}
+#endif
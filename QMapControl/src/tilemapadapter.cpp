@@ -24,10 +24,26 @@
 */
 
 #include "tilemapadapter.h"
+#include <typeinfo>
+
+namespace
+{
+    // the Web Mercator projection, shared by the single and the batch functions so they agree to the pixel
+    inline qreal mercatorX(qreal longitude, qreal width)
+    {
+        return (longitude+180) * width/360.; // coord to pixel!
+    }
+
+    inline qreal mercatorY(qreal latitude, qreal width, qreal pi)
+    {
+        return (1-(log(tan(pi/4+latitude*(pi/180.0)/2)) /pi)) /2  * width;
+    }
+}
+
 namespace qmapcontrol
 {
     TileMapAdapter::TileMapAdapter(const QString& host, const QString& serverPath, int tilesize, int minZoom, int maxZoom)
-            :MapAdapter(host, serverPath, tilesize, minZoom, maxZoom)
+            :MapAdapter(host, serverPath, tilesize, minZoom, maxZoom), projectionInherited(false)
     {
         PI = acos(-1.0);
 
@@ -138,12 +154,31 @@ namespace qmapcontrol
 
     }
 
+    void TileMapAdapter::setProjectionInherited(bool inherited)
+    {
+        projectionInherited = inherited;
+    }
+
+    bool TileMapAdapter::ownProjection() const
+    {
+        // a TileMapAdapter which isn't subclassed always projects itself
+        return projectionInherited || typeid(*this) == typeid(TileMapAdapter);
+    }
+
     QPoint TileMapAdapter::coordinateToDisplay(const QPointF& coordinate) const
     {
-        qreal x = (coordinate.x()+180) * (mNumberOfTiles*mTileSize)/360.; // coord to pixel!
-        qreal y = (1-(log(tan(PI/4+deg_rad(coordinate.y())/2)) /PI)) /2  * (mNumberOfTiles*mTileSize);
+        const qreal width = mNumberOfTiles*mTileSize;
+        return QPoint(int(mercatorX(coordinate.x(), width)), int(mercatorY(coordinate.y(), width, PI)));
+    }
 
-        return QPoint(int(x), int(y));
+    QPointF TileMapAdapter::coordinateToDisplayF(const QPointF& coordinate) const
+    {
+        if (!ownProjection())
+        {
+            return MapAdapter::coordinateToDisplayF(coordinate);
+        }
+        const qreal width = mNumberOfTiles*mTileSize;
+        return QPointF(mercatorX(coordinate.x(), width), mercatorY(coordinate.y(), width, PI));
     }
 
     QPointF TileMapAdapter::displayToCoordinate(const QPoint& point) const
@@ -155,6 +190,54 @@ namespace qmapcontrol
 
     }
 
+    void TileMapAdapter::coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const
+    {
+        if (!ownProjection())
+        {
+            MapAdapter::coordinatesToDisplay(coordinates, points, count);
+            return;
+        }
+
+        const qreal width = mNumberOfTiles*mTileSize;
+        for (int i=0; i<count; ++i)
+        {
+            points[i] = QPoint(int(mercatorX(coordinates[i].x(), width)), int(mercatorY(coordinates[i].y(), width, PI)));
+        }
+    }
+
+    void TileMapAdapter::coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const
+    {
+        if (!ownProjection())
+        {
+            MapAdapter::coordinatesToDisplayF(coordinates, points, count);
+            return;
+        }
+
+        const qreal width = mNumberOfTiles*mTileSize;
+        for (int i=0; i<count; ++i)
+        {
+            points[i] = QPointF(mercatorX(coordinates[i].x(), width), mercatorY(coordinates[i].y(), width, PI));
+        }
+    }
+
+    void TileMapAdapter::displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const
+    {
+        if (!ownProjection())
+        {
+            MapAdapter::displayToCoordinates(points, coordinates, count);
+            return;
+        }
+
+        const qreal width = mNumberOfTiles*mTileSize;
+        const qreal xFactor = 360/width;
+        const qreal yFactor = 2/width;
+
+        for (int i=0; i<count; ++i)
+        {
+            coordinates[i] = QPointF((points[i].x()*xFactor)-180, rad_deg(atan(sinh((1-points[i].y()*yFactor)*PI))));
+        }
+    }
+
     bool TileMapAdapter::isTileValid(int x, int y, int z) const
     {
         if (mMax_zoom < mMin_zoom)
@@ -57,11 +57,24 @@ namespace qmapcontrol
         virtual ~TileMapAdapter();
 
         virtual QPoint coordinateToDisplay(const QPointF&) const;
+        virtual QPointF coordinateToDisplayF(const QPointF&) const;
         virtual QPointF displayToCoordinate(const QPoint&) const;
+        virtual void coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const;
+        virtual void coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const;
+        virtual void displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const;
 
         qreal PI;
 
     protected:
+        //! tells that the subclass keeps the projection of the TileMapAdapter
+        /*!
+         * coordinateToDisplayF() and the translations of many coordinates compute the projection themselves.
+         * In a subclass they only do so after it called this. Otherwise they call coordinateToDisplay() and
+         * displayToCoordinate(), so a subclass which reimplements these is still drawn right.
+         * @param inherited true if the subclass doesn't reimplement coordinateToDisplay() and displayToCoordinate()
+         */
+        void setProjectionInherited(bool inherited = true);
+
         qreal rad_deg(qreal) const;
         qreal deg_rad(qreal) const;
 
@@ -72,6 +85,11 @@ namespace qmapcontrol
         virtual int tilesonzoomlevel(int zoomlevel) const;
         virtual int xoffset(int x) const;
         virtual int yoffset(int y) const;
+
+    private:
+        bool ownProjection() const;
+
+        bool projectionInherited;
     };
 }
 #endif
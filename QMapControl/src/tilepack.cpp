@@ -0,0 +1,164 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "tilepack.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace
+{
+    // compares a tile with an index entry in the order of the index
+    int compareTile(int x, int y, int z, const uchar* entry)
+    {
+        const int values[3] = { z, x, y };
+        for (int i=0; i<3; ++i)
+        {
+            const qint32 value = qFromLittleEndian<qint32>(entry + i*4);
+            if (values[i] != value)
+            {
+                return values[i] < value ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+}
+
+namespace qmapcontrol
+{
+    const char TilePack::Magic[8] = { 'Q', 'M', 'C', 'T', 'P', 'A', 'C', 'K' };
+
+    TilePack::TilePack(const QString& fileName)
+        :   file(fileName),
+            data(0),
+            dataSize(0),
+            index(0),
+            count(0),
+            mTileSize(256),
+            mMinZoom(0),
+            mMaxZoom(0)
+    {
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            qDebug() << "TilePack::TilePack() - cannot open" << fileName;
+            return;
+        }
+
+        dataSize = file.size();
+        data = dataSize >= HeaderSize ? file.map(0, dataSize) : 0;
+        if (data == 0 || memcmp(data, Magic, sizeof(Magic)) != 0 ||
+            qFromLittleEndian<quint32>(data + 8) != quint32(Version))
+        {
+            qDebug() << "TilePack::TilePack() - not a tile pack:" << fileName;
+            data = 0;
+            file.close();
+            return;
+        }
+
+        const quint32 tiles = qFromLittleEndian<quint32>(data + 24);
+        const quint64 indexOffset = qFromLittleEndian<quint64>(data + 32);
+        if (indexOffset < quint64(HeaderSize) || indexOffset > quint64(dataSize) ||
+            quint64(tiles) > (quint64(dataSize) - indexOffset) / IndexEntrySize)
+        {
+            qDebug() << "TilePack::TilePack() - the index of" << fileName << "is damaged";
+            data = 0;
+            file.close();
+            return;
+        }
+
+        mTileSize = int(qFromLittleEndian<quint32>(data + 12));
+        mMinZoom = qFromLittleEndian<qint32>(data + 16);
+        mMaxZoom = qFromLittleEndian<qint32>(data + 20);
+        count = int(tiles);
+        index = data + indexOffset;
+    }
+
+    TilePack::~TilePack()
+    {
+        // closing the file unmaps it
+        file.close();
+    }
+
+    bool TilePack::isOpen() const
+    {
+        return data != 0;
+    }
+
+    QByteArray TilePack::tileData(int x, int y, int z) const
+    {
+        if (data == 0)
+        {
+            return QByteArray();
+        }
+
+        int low = 0;
+        int high = count - 1;
+        while (low <= high)
+        {
+            const int middle = low + (high - low) / 2;
+            const uchar* entry = index + qint64(middle) * IndexEntrySize;
+            const int comparison = compareTile(x, y, z, entry);
+            if (comparison < 0)
+            {
+                high = middle - 1;
+            }
+            else if (comparison > 0)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                const quint32 length = qFromLittleEndian<quint32>(entry + 12);
+                const quint64 offset = qFromLittleEndian<quint64>(entry + 16);
+                if (offset > quint64(dataSize) || length > quint64(dataSize) - offset)
+                {
+                    return QByteArray();
+                }
+                return QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset), int(length));
+            }
+        }
+        return QByteArray();
+    }
+
+    int TilePack::tileSize() const
+    {
+        return mTileSize;
+    }
+
+    int TilePack::minZoom() const
+    {
+        return mMinZoom;
+    }
+
+    int TilePack::maxZoom() const
+    {
+        return mMaxZoom;
+    }
+
+    int TilePack::tileCount() const
+    {
+        return count;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILEPACK_H
+#define TILEPACK_H
+
+#include "qmapcontrol_global.h"
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+namespace qmapcontrol
+{
+    //! Read access to a tile pack file
+    /*!
+     * A tile pack stores the tiles of a map in a single file, so they can be used without a network.
+     * The file is memory mapped and a tile is found by a binary search in its index,
+     * no tile data is copied until it is decoded.
+     *
+     * The file layout, all numbers little endian:
+     *  - header (40 bytes): "QMCTPACK", quint32 version (1), quint32 tile size, qint32 min zoom,
+     *    qint32 max zoom, quint32 tile count, quint32 reserved, quint64 offset of the index
+     *  - the encoded tile images (PNG, JPEG, ...), one after another
+     *  - the index, one entry (24 bytes) per tile sorted by zoom, x and y:
+     *    qint32 zoom, qint32 x, qint32 y, quint32 length, quint64 offset of the image
+     *
+     * Tile packs are written by TilePackWriter. x and y are the tile numbers as used by TileMapAdapter.
+     * @see TilePackWriter, @see TilePackMapAdapter
+     */
+    class QMAPCONTROL_EXPORT TilePack
+    {
+    public:
+        //! opens a tile pack
+        /*!
+         * @param fileName the tile pack file
+         */
+        TilePack(const QString& fileName);
+        ~TilePack();
+
+        //! returns true if the file is a valid tile pack
+        bool isOpen() const;
+
+        //! returns the encoded image of a tile
+        /*!
+         * The returned data refers to the mapped file and is valid as long as the TilePack exists.
+         * @param x the x value of the tile
+         * @param y the y value of the tile
+         * @param z the zoom value of the tile
+         * @return the encoded image, or an empty array if the pack does not contain the tile
+         */
+        QByteArray tileData(int x, int y, int z) const;
+
+        int tileSize() const;
+        int minZoom() const;
+        int maxZoom() const;
+        int tileCount() const;
+
+        static const char Magic[8];
+        static const int Version = 1;
+        static const int HeaderSize = 40;
+        static const int IndexEntrySize = 24;
+
+    private:
+        Q_DISABLE_COPY (TilePack)
+
+        QFile file;
+        const uchar* data;
+        qint64 dataSize;
+        const uchar* index;
+        int count;
+        int mTileSize;
+        int mMinZoom;
+        int mMaxZoom;
+    };
+}
+#endif
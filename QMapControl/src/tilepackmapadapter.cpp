@@ -0,0 +1,62 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "tilepackmapadapter.h"
+namespace qmapcontrol
+{
+    TilePackMapAdapter::TilePackMapAdapter(const QString& fileName)
+            : TileMapAdapter(QString(), "/%1/%2/%3", 256, 0, 17),
+              pack(fileName)
+    {
+        setProjectionInherited();
+        if (pack.isOpen())
+        {
+            mTileSize = pack.tileSize();
+            mMin_zoom = pack.minZoom();
+            mMax_zoom = pack.maxZoom();
+            mCurrent_zoom = mMin_zoom;
+            mNumberOfTiles = tilesonzoomlevel(mCurrent_zoom);
+        }
+    }
+
+    TilePackMapAdapter::~TilePackMapAdapter()
+    {
+    }
+
+    bool TilePackMapAdapter::isOpen() const
+    {
+        return pack.isOpen();
+    }
+
+    bool TilePackMapAdapter::hasLocalTiles() const
+    {
+        return true;
+    }
+
+    QByteArray TilePackMapAdapter::tileData(int x, int y, int z) const
+    {
+        return pack.tileData(xoffset(x), yoffset(y), z);
+    }
+}
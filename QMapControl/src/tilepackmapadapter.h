@@ -0,0 +1,67 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILEPACKMAPADAPTER_H
+#define TILEPACKMAPADAPTER_H
+
+#include "qmapcontrol_global.h"
+#include "tilemapadapter.h"
+#include "tilepack.h"
+
+namespace qmapcontrol
+{
+    //! MapAdapter for tiles from a local tile pack
+    /*!
+     * The tiles are read from a single tile pack file instead of a tile server, so no network is needed.
+     * They are read and decoded when they are painted, without going through the network queue.
+     * The tile pack uses the tile numbers of the OpenStreetMap (Mercator) tiles.
+     *
+     * The zoom range and tile size are taken from the tile pack.
+     * @see TilePack, @see TilePackWriter
+     */
+    class QMAPCONTROL_EXPORT TilePackMapAdapter : public TileMapAdapter
+    {
+        Q_OBJECT
+                public:
+        //! constructor
+        /*!
+         * This constructs a MapAdapter for a tile pack file
+         * @param fileName the tile pack file
+         */
+        TilePackMapAdapter(const QString& fileName);
+        virtual ~TilePackMapAdapter();
+
+        //! returns true if the tile pack could be opened
+        bool isOpen() const;
+
+    protected:
+        virtual bool hasLocalTiles() const;
+        virtual QByteArray tileData(int x, int y, int z) const;
+
+    private:
+        TilePack pack;
+    };
+}
+#endif
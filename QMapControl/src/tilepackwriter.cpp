@@ -0,0 +1,141 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "tilepackwriter.h"
+#include "tilepack.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace
+{
+    quint64 indexKey(int x, int y, int z)
+    {
+        return (quint64(quint32(z) & 0xff) << 48) | (quint64(quint32(x) & 0xffffff) << 24) | quint64(quint32(y) & 0xffffff);
+    }
+}
+
+namespace qmapcontrol
+{
+    TilePackWriter::TilePackWriter(const QString& fileName, int tilesize)
+        :   file(fileName),
+            mTileSize(tilesize),
+            mMinZoom(0),
+            mMaxZoom(0),
+            failed(false)
+    {
+        // the header is written again with the index offset by finish()
+        failed = !file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writeHeader(0);
+        if (failed)
+        {
+            qDebug() << "TilePackWriter::TilePackWriter() - cannot create" << fileName;
+        }
+    }
+
+    TilePackWriter::~TilePackWriter()
+    {
+        if (file.isOpen())
+        {
+            finish();
+        }
+    }
+
+    bool TilePackWriter::isOpen() const
+    {
+        return file.isOpen() && !failed;
+    }
+
+    bool TilePackWriter::addTile(int x, int y, int z, const QByteArray& image)
+    {
+        if (!isOpen() || image.isEmpty() || z < 0 || z > 24 || x < 0 || y < 0 || x >= (1 << 24) || y >= (1 << 24))
+        {
+            return false;
+        }
+
+        const quint64 offset = quint64(file.pos());
+        if (file.write(image) != image.size())
+        {
+            failed = true;
+            return false;
+        }
+
+        if (tiles.isEmpty())
+        {
+            mMinZoom = z;
+            mMaxZoom = z;
+        }
+        mMinZoom = qMin(mMinZoom, z);
+        mMaxZoom = qMax(mMaxZoom, z);
+        tiles.insert(indexKey(x, y, z), qMakePair(offset, quint32(image.size())));
+        return true;
+    }
+
+    bool TilePackWriter::finish()
+    {
+        if (!file.isOpen())
+        {
+            return false;
+        }
+
+        const quint64 indexOffset = quint64(file.pos());
+        QByteArray entry(TilePack::IndexEntrySize, 0);
+        uchar* bytes = reinterpret_cast<uchar*>(entry.data());
+
+        QMapIterator<quint64, QPair<quint64, quint32> > it(tiles);
+        while (it.hasNext() && !failed)
+        {
+            it.next();
+            qToLittleEndian<qint32>(qint32((it.key() >> 48) & 0xff), bytes);
+            qToLittleEndian<qint32>(qint32((it.key() >> 24) & 0xffffff), bytes + 4);
+            qToLittleEndian<qint32>(qint32(it.key() & 0xffffff), bytes + 8);
+            qToLittleEndian<quint32>(it.value().second, bytes + 12);
+            qToLittleEndian<quint64>(it.value().first, bytes + 16);
+            failed = file.write(entry) != entry.size();
+        }
+
+        failed = failed || !file.seek(0) || !writeHeader(indexOffset);
+        file.close();
+        return !failed;
+    }
+
+    int TilePackWriter::tileCount() const
+    {
+        return tiles.size();
+    }
+
+    bool TilePackWriter::writeHeader(quint64 indexOffset)
+    {
+        QByteArray header(TilePack::HeaderSize, 0);
+        uchar* bytes = reinterpret_cast<uchar*>(header.data());
+        memcpy(bytes, TilePack::Magic, sizeof(TilePack::Magic));
+        qToLittleEndian<quint32>(quint32(TilePack::Version), bytes + 8);
+        qToLittleEndian<quint32>(quint32(mTileSize), bytes + 12);
+        qToLittleEndian<qint32>(qint32(mMinZoom), bytes + 16);
+        qToLittleEndian<qint32>(qint32(mMaxZoom), bytes + 20);
+        qToLittleEndian<quint32>(quint32(tiles.size()), bytes + 24);
+        qToLittleEndian<quint64>(indexOffset, bytes + 32);
+        return file.write(header) == header.size();
+    }
+}
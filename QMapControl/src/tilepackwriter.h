@@ -0,0 +1,93 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILEPACKWRITER_H
+#define TILEPACKWRITER_H
+
+#include "qmapcontrol_global.h"
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <QMap>
+#include <QPair>
+
+namespace qmapcontrol
+{
+    //! Writes a tile pack file
+    /*!
+     * The tiles are written to the file as they are added, only the index is kept in memory.
+     * The pack is complete after finish() was called.
+     * Tiles up to zoom level 24 can be stored.
+     * @see TilePack for the file layout
+     */
+    class QMAPCONTROL_EXPORT TilePackWriter
+    {
+    public:
+        //! creates a tile pack, an existing file is overwritten
+        /*!
+         * @param fileName the tile pack file
+         * @param tilesize the size of the tiles
+         */
+        TilePackWriter(const QString& fileName, int tilesize = 256);
+        ~TilePackWriter();
+
+        //! returns true if the file could be created
+        bool isOpen() const;
+
+        //! adds the encoded image of a tile
+        /*!
+         * A tile which is added again replaces the previous image in the index.
+         * @param x the x value of the tile
+         * @param y the y value of the tile
+         * @param z the zoom value of the tile
+         * @param image the encoded image, e.g. PNG or JPEG
+         * @return true if the tile was written
+         */
+        bool addTile(int x, int y, int z, const QByteArray& image);
+
+        //! writes the index and closes the file
+        /*!
+         * @return true if the pack was written completely
+         */
+        bool finish();
+
+        //! returns the number of tiles in the pack
+        int tileCount() const;
+
+    private:
+        Q_DISABLE_COPY (TilePackWriter)
+
+        bool writeHeader(quint64 indexOffset);
+
+        QFile file;
+        int mTileSize;
+        int mMinZoom;
+        int mMaxZoom;
+        bool failed;
+        // offset and length of each tile, the key sorts like the index of the pack
+        QMap<quint64, QPair<quint64, quint32> > tiles;
+    };
+}
+#endif
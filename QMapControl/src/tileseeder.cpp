@@ -0,0 +1,362 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#include "tileseeder.h"
+#include "mapadapter.h"
+#include "mapnetwork.h"
+#include "tilepackwriter.h"
+#include "tilekey.h"
+#include <QNetworkRequest>
+#include <QDateTime>
+#include <QTimer>
+#include <QUrl>
+
+// the Mercator projection does not reach the poles
+static const qreal kMaxLatitude = 85.0511;
+// failed tiles are loaded again after this delay, which doubles with each failure, like the tiles of the map
+static const int kRetryDelayMs = 5000;
+static const int kMaxRetryDelayMs = 1800000;
+
+namespace qmapcontrol
+{
+    TileSeeder::TileSeeder(QObject* parent)
+        :   QObject(parent),
+            http(new QNetworkAccessManager(this)),
+            diskCache(0),
+            pack(0),
+            agent(MapNetwork::userAgent()),
+            maxRequests(4),
+            maxRetries(3),
+            total(0),
+            done(0),
+            failed(0),
+            bytes(0),
+            active(false)
+    {
+        connect(http, SIGNAL(finished(QNetworkReply *)), this, SLOT(requestFinished(QNetworkReply *)));
+    }
+
+    TileSeeder::~TileSeeder()
+    {
+        // nobody is told about the end, the slots of the receivers must not see a half destroyed seeder
+        disconnect(http, 0, this, 0);
+        cancelRequests();
+        delete pack;
+        pack = 0;
+    }
+
+    void TileSeeder::setCacheDir(const QDir& path, const int qDiskSizeMB)
+    {
+        QDir cacheDir = path;
+        if (!cacheDir.exists())
+        {
+            cacheDir.mkpath( cacheDir.absolutePath() );
+        }
+
+        if (!diskCache)
+        {
+            diskCache = new QNetworkDiskCache(this);
+        }
+        diskCache->setCacheDirectory( cacheDir.absolutePath() );
+        diskCache->setMaximumCacheSize( qint64(qDiskSizeMB) *1024*1024 ); //Megabytes to bytes
+        http->setCache(diskCache);
+    }
+
+    void TileSeeder::setTilePack(const QString& fileName)
+    {
+        packFileName = fileName;
+    }
+
+    void TileSeeder::setMaxConcurrentRequests(int requests)
+    {
+        maxRequests = qMax(1, requests);
+    }
+
+    void TileSeeder::setMaxRetries(int retries)
+    {
+        maxRetries = qMax(0, retries);
+    }
+
+    void TileSeeder::setUserAgent(const QByteArray& userAgent)
+    {
+        agent = userAgent;
+    }
+
+    int TileSeeder::start(MapAdapter* adapter, const QRectF& area, int fromZoom, int toZoom)
+    {
+        abort();
+
+        queue.clear();
+        total = 0;
+        done = 0;
+        failed = 0;
+        bytes = 0;
+
+        if (!packFileName.isEmpty())
+        {
+            pack = new TilePackWriter(packFileName, adapter->tilesize());
+            if (!pack->isOpen())
+            {
+                delete pack;
+                pack = 0;
+            }
+        }
+
+        const int zoom = adapter->currentZoom();
+        for (int z=qMin(fromZoom, toZoom); z<=qMax(fromZoom, toZoom); ++z)
+        {
+            if (zoomAdapter(adapter, z))
+            {
+                enumerate(adapter, area, z);
+            }
+        }
+        zoomAdapter(adapter, zoom);
+
+        total = queue.size();
+        active = true;
+        time.start();
+
+        // also reports an empty area asynchronously
+        QTimer::singleShot(0, this, SLOT(startRequests()));
+        return total;
+    }
+
+    void TileSeeder::abort()
+    {
+        cancelRequests();
+        finish();
+    }
+
+    void TileSeeder::cancelRequests()
+    {
+        queue.clear();
+        retries.clear();
+
+        // aborting emits finished(), the replies must not be found anymore
+        const QList<QNetworkReply*> replies = running.keys();
+        running.clear();
+        foreach(QNetworkReply* reply, replies)
+        {
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+
+    bool TileSeeder::isRunning() const
+    {
+        return active;
+    }
+
+    int TileSeeder::totalTiles() const
+    {
+        return total;
+    }
+
+    int TileSeeder::finishedTiles() const
+    {
+        return done;
+    }
+
+    int TileSeeder::failedTiles() const
+    {
+        return failed;
+    }
+
+    qint64 TileSeeder::loadedBytes() const
+    {
+        return bytes;
+    }
+
+    qreal TileSeeder::tilesPerSecond() const
+    {
+        const qint64 elapsed = time.isValid() ? time.elapsed() : 0;
+        return elapsed > 0 ? (done - failed) * 1000.0 / elapsed : 0.0;
+    }
+
+    qreal TileSeeder::bytesPerSecond() const
+    {
+        const qint64 elapsed = time.isValid() ? time.elapsed() : 0;
+        return elapsed > 0 ? bytes * 1000.0 / elapsed : 0.0;
+    }
+
+    bool TileSeeder::zoomAdapter(MapAdapter* adapter, int zoom)
+    {
+        // MapAdapters only zoom one level at a time
+        const bool reversed = adapter->maxZoom() < adapter->minZoom();
+        while (adapter->currentZoom() != zoom)
+        {
+            const int previous = adapter->currentZoom();
+            if ((zoom > previous) != reversed)
+            {
+                adapter->zoom_in();
+            }
+            else
+            {
+                adapter->zoom_out();
+            }
+
+            if (adapter->currentZoom() == previous)
+            {
+                // the zoom is out of the range of the MapAdapter
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void TileSeeder::enumerate(MapAdapter* adapter, const QRectF& area, int zoom)
+    {
+        const qreal west = qMin(area.left(), area.right());
+        const qreal east = qMax(area.left(), area.right());
+        const qreal north = qMin(qMax(area.top(), area.bottom()), kMaxLatitude);
+        const qreal south = qMax(qMin(area.top(), area.bottom()), -kMaxLatitude);
+
+        const QPoint topLeft = adapter->coordinateToDisplay(QPointF(west, north));
+        const QPoint bottomRight = adapter->coordinateToDisplay(QPointF(east, south));
+        const int tilesize = adapter->tilesize();
+
+        QHash<QString, QString> baseUrls;
+        for (int x=tileIndex(topLeft.x(), tilesize); x<=tileIndex(bottomRight.x(), tilesize); ++x)
+        {
+            for (int y=tileIndex(topLeft.y(), tilesize); y<=tileIndex(bottomRight.y(), tilesize); ++y)
+            {
+                if (!adapter->isTileValid(x, y, zoom))
+                {
+                    continue;
+                }
+
+                const QString host = adapter->tileHost(x, y, zoom);
+                if (!baseUrls.contains(host))
+                {
+                    baseUrls.insert(host, MapNetwork::hostBaseUrl(host));
+                }
+
+                SeedTile tile;
+                tile.x = x;
+                tile.y = y;
+                tile.z = adapter->adaptedZoom();
+                tile.url = baseUrls.value(host) + adapter->query(x, y, zoom);
+                tile.attempts = 0;
+                tile.retryAt = 0;
+                queue.append(tile);
+            }
+        }
+    }
+
+    void TileSeeder::startRequests()
+    {
+        // failed tiles are loaded again after the other queued tiles
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QMutableListIterator<SeedTile> it(retries);
+        while (it.hasNext())
+        {
+            if (it.next().retryAt <= now)
+            {
+                queue.append(it.value());
+                it.remove();
+            }
+        }
+
+        while (running.size() < maxRequests && !queue.isEmpty())
+        {
+            const SeedTile tile = queue.takeFirst();
+            QNetworkRequest request = QNetworkRequest(QUrl(tile.url));
+            if (diskCache)
+            {
+                // tiles which are cached already are not loaded again
+                request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache );
+                request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
+            }
+            request.setRawHeader("User-Agent", agent);
+            running.insert(http->get(request), tile);
+        }
+
+        if (running.isEmpty() && queue.isEmpty() && retries.isEmpty())
+        {
+            finish();
+        }
+    }
+
+    void TileSeeder::requestFinished(QNetworkReply* reply)
+    {
+        QHash<QNetworkReply*, SeedTile>::iterator it = running.find(reply);
+        if (it == running.end())
+        {
+            // aborted
+            reply->deleteLater();
+            return;
+        }
+
+        SeedTile tile = it.value();
+        running.erase(it);
+
+        if (reply->error() == QNetworkReply::NoError)
+        {
+            const QByteArray data = reply->readAll();
+            bytes += data.size();
+            if (pack)
+            {
+                pack->addTile(tile.x, tile.y, tile.z, data);
+            }
+            ++done;
+        }
+        else if (reply->error() == QNetworkReply::ContentNotFoundError || ++tile.attempts > maxRetries)
+        {
+            qDebug() << "TileSeeder::requestFinished() - cannot load" << tile.url << reply->errorString();
+            ++failed;
+            ++done;
+        }
+        else
+        {
+            // the server may be overloaded, so it is given some time
+            const int delay = qMin(kRetryDelayMs << qMin(tile.attempts - 1, 10), kMaxRetryDelayMs);
+            tile.retryAt = QDateTime::currentMSecsSinceEpoch() + delay;
+            retries.append(tile);
+            QTimer::singleShot(delay, this, SLOT(startRequests()));
+        }
+        reply->deleteLater();
+
+        emit progress(done, total);
+        startRequests();
+    }
+
+    void TileSeeder::finish()
+    {
+        if (!active)
+        {
+            return;
+        }
+        active = false;
+
+        if (pack)
+        {
+            pack->finish();
+            delete pack;
+            pack = 0;
+        }
+
+        emit finished(failed);
+    }
+}
@@ -0,0 +1,191 @@
+/*
+*
+* This file is part of QMapControl,
+* an open-source cross-platform map widget
+*
+* Copyright (C) 2007 - 2008 Kai Winter
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with QMapControl. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contact e-mail: kaiwinter@gmx.de
+* Program URL   : http://qmapcontrol.sourceforge.net/
+*
+*/
+
+#ifndef TILESEEDER_H
+#define TILESEEDER_H
+
+#include "qmapcontrol_global.h"
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+#include <QNetworkReply>
+#include <QRectF>
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+
+namespace qmapcontrol
+{
+    class MapAdapter;
+    class TilePackWriter;
+
+    //! Downloads all tiles of an area in advance
+    /*!
+     * The tiles of a bounding box are loaded for a range of zoom levels, so the area can be used offline.
+     * They are saved to a persistent cache, which can be used by MapControl::enablePersistentCache(),
+     * and/or to a tile pack, which can be shown by a TilePackMapAdapter.
+     *
+     * The tiles are enumerated with the MapAdapter when seeding starts. This changes the zoom
+     * of the MapAdapter for a moment, so it should not be one which is displayed at the same time.
+     * Failed requests are repeated after a growing delay, tiles the server does not have are not.
+     *
+     * Many tile servers, like tile.openstreetmap.org, do not allow to load areas in advance. Respect
+     * the usage policy of the server and identify your application with setUserAgent().
+     * @see TilePackMapAdapter
+     */
+    class QMAPCONTROL_EXPORT TileSeeder : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        TileSeeder(QObject* parent = 0);
+        ~TileSeeder();
+
+        //! saves the tiles to a persistent cache
+        /*!
+         * @param path the cache directory, the same as given to MapControl::enablePersistentCache()
+         * @param qDiskSizeMB the maximum size of the cache in megabytes
+         */
+        void setCacheDir(const QDir& path, const int qDiskSizeMB = 250);
+
+        //! writes the tiles to a tile pack
+        /*!
+         * The tile pack is created when seeding starts and completed when it has finished.
+         * @param fileName the tile pack file, an existing file is overwritten
+         */
+        void setTilePack(const QString& fileName);
+
+        //! sets how many tiles are loaded at the same time
+        /*!
+         * @param requests the number of parallel requests, default is 4
+         */
+        void setMaxConcurrentRequests(int requests);
+
+        //! sets how often a failed request is repeated
+        /*!
+         * @param retries the number of repetitions, default is 3
+         */
+        void setMaxRetries(int retries);
+
+        //! sets the User-Agent header sent with the requests
+        /*!
+         * @param userAgent the User-Agent, which should identify the application, default is MapNetwork::userAgent()
+         */
+        void setUserAgent(const QByteArray& userAgent);
+
+        //! starts loading the tiles of an area
+        /*!
+         * @param adapter the MapAdapter which forms the tile requests
+         * @param area the bounding box in world coordinates (longitude, latitude)
+         * @param fromZoom the first zoom level
+         * @param toZoom the last zoom level
+         * @return the number of tiles which will be loaded
+         */
+        int start(MapAdapter* adapter, const QRectF& area, int fromZoom, int toZoom);
+
+        //! stops loading
+        /*!
+         * The tiles loaded so far are kept and finished() is emitted.
+         */
+        void abort();
+
+        //! returns true while tiles are loaded
+        bool isRunning() const;
+
+        //! returns the number of tiles to load
+        int totalTiles() const;
+
+        //! returns the number of tiles which are done, failed tiles included
+        int finishedTiles() const;
+
+        //! returns the number of tiles which could not be loaded
+        int failedTiles() const;
+
+        //! returns the number of loaded bytes
+        qint64 loadedBytes() const;
+
+        //! returns the loaded tiles per second since the start
+        qreal tilesPerSecond() const;
+
+        //! returns the loaded bytes per second since the start
+        qreal bytesPerSecond() const;
+
+    signals:
+        //! emitted after each finished tile
+        /*!
+         * @param finished the number of finished tiles, failed tiles included
+         * @param total the number of tiles to load
+         */
+        void progress(int finished, int total);
+
+        //! emitted when all tiles are finished
+        /*!
+         * @param failed the number of tiles which could not be loaded
+         */
+        void finished(int failed);
+
+    private:
+        Q_DISABLE_COPY (TileSeeder)
+
+        struct SeedTile
+        {
+            int x;
+            int y;
+            int z; // zoom as used by the tile pack
+            QString url;
+            int attempts;
+            qint64 retryAt; // msecs since epoch
+        };
+
+        static bool zoomAdapter(MapAdapter* adapter, int zoom);
+        void enumerate(MapAdapter* adapter, const QRectF& area, int zoom);
+        void cancelRequests();
+        void finish();
+
+        QNetworkAccessManager* http;
+        QNetworkDiskCache* diskCache;
+        TilePackWriter* pack;
+        QString packFileName;
+
+        QList<SeedTile> queue;
+        QList<SeedTile> retries; // failed tiles waiting for their delay
+        QHash<QNetworkReply*, SeedTile> running;
+        QByteArray agent;
+        int maxRequests;
+        int maxRetries;
+        int total;
+        int done;
+        int failed;
+        qint64 bytes;
+        QElapsedTimer time;
+        bool active;
+
+    private slots:
+        void startRequests();
+        void requestFinished(QNetworkReply* reply);
+    };
+}
+#endif
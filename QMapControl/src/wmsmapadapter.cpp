@@ -25,11 +25,23 @@
 
 #include "wmsmapadapter.h"
 #include <QStringList>
+#include <typeinfo>
+
+namespace
+{
+    // the projection of coordinateToDisplay() and coordinateToDisplayF()
+    inline QPointF project(const QPointF& coordinate, qreal width)
+    {
+        qreal x = (coordinate.x()+180) * width/360.; // coord to pixel!
+        qreal y = -1*(coordinate.y()-90) * width/180.; // coord to pixel!
+        return QPointF(x, y);
+    }
+}
 
 namespace qmapcontrol
 {
     WMSMapAdapter::WMSMapAdapter(QString host, QString serverPath, int tilesize)
-            : MapAdapter(host, serverPath, tilesize, 0, 17)
+            : MapAdapter(host, serverPath, tilesize, 0, 17), projectionInherited(false)
     {
         mNumberOfTiles = pow(2.0, mCurrent_zoom);
         coord_per_x_tile = 360. / mNumberOfTiles;
@@ -131,11 +143,29 @@ namespace qmapcontrol
         return QString("%1?%2").arg( MapAdapter::serverPath() ).arg( urlPath );
     }
 
+    void WMSMapAdapter::setProjectionInherited(bool inherited)
+    {
+        projectionInherited = inherited;
+    }
+
+    bool WMSMapAdapter::ownProjection() const
+    {
+        // a WMSMapAdapter which isn't subclassed always projects itself
+        return projectionInherited || typeid(*this) == typeid(WMSMapAdapter);
+    }
+
     QPoint WMSMapAdapter::coordinateToDisplay(const QPointF& coordinate) const
     {
-        qreal x = (coordinate.x()+180) * (mNumberOfTiles*mTileSize)/360.; // coord to pixel!
-        qreal y = -1*(coordinate.y()-90) * (mNumberOfTiles*mTileSize)/180.; // coord to pixel!
-        return QPoint(int(x), int(y));
+        const QPointF point = project(coordinate, mNumberOfTiles*mTileSize);
+        return QPoint(int(point.x()), int(point.y()));
+    }
+    QPointF WMSMapAdapter::coordinateToDisplayF(const QPointF& coordinate) const
+    {
+        if (!ownProjection())
+        {
+            return MapAdapter::coordinateToDisplayF(coordinate);
+        }
+        return project(coordinate, mNumberOfTiles*mTileSize);
     }
     QPointF WMSMapAdapter::displayToCoordinate(const QPoint& point) const
     {
@@ -143,6 +173,52 @@ namespace qmapcontrol
         qreal lat = -(point.y()*(180./(mNumberOfTiles*mTileSize)))+90;
         return QPointF(lon, lat);
     }
+    void WMSMapAdapter::coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const
+    {
+        if (!ownProjection())
+        {
+            MapAdapter::coordinatesToDisplay(coordinates, points, count);
+            return;
+        }
+
+        // the same expressions as coordinateToDisplay(), so both give the same pixels
+        const qreal width = mNumberOfTiles*mTileSize;
+        for (int i=0; i<count; ++i)
+        {
+            const qreal x = (coordinates[i].x()+180) * width/360.;
+            const qreal y = -1*(coordinates[i].y()-90) * width/180.;
+            points[i] = QPoint(int(x), int(y));
+        }
+    }
+    void WMSMapAdapter::coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const
+    {
+        if (!ownProjection())
+        {
+            MapAdapter::coordinatesToDisplayF(coordinates, points, count);
+            return;
+        }
+
+        const qreal width = mNumberOfTiles*mTileSize;
+        for (int i=0; i<count; ++i)
+        {
+            points[i] = QPointF((coordinates[i].x()+180) * width/360., -1*(coordinates[i].y()-90) * width/180.);
+        }
+    }
+    void WMSMapAdapter::displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const
+    {
+        if (!ownProjection())
+        {
+            MapAdapter::displayToCoordinates(points, coordinates, count);
+            return;
+        }
+
+        const qreal xFactor = 360./(mNumberOfTiles*mTileSize);
+        const qreal yFactor = 180./(mNumberOfTiles*mTileSize);
+        for (int i=0; i<count; ++i)
+        {
+            coordinates[i] = QPointF((points[i].x()*xFactor)-180, -(points[i].y()*yFactor)+90);
+        }
+    }
     void WMSMapAdapter::zoom_in()
     {
         mCurrent_zoom+=1;
@@ -54,16 +54,30 @@ namespace qmapcontrol
 
         virtual QString serverPath() const;
         virtual QPoint coordinateToDisplay(const QPointF&) const;
+        virtual QPointF coordinateToDisplayF(const QPointF&) const;
         virtual QPointF displayToCoordinate(const QPoint&) const;
+        virtual void coordinatesToDisplay(const QPointF* coordinates, QPoint* points, int count) const;
+        virtual void coordinatesToDisplayF(const QPointF* coordinates, QPointF* points, int count) const;
+        virtual void displayToCoordinates(const QPoint* points, QPointF* coordinates, int count) const;
         virtual void changeHostAddress( const QString qHost, const QString qServerPath = QString() );
 
     protected:
+        //! tells that the subclass keeps the projection of the WMSMapAdapter
+        /*!
+         * coordinateToDisplayF() and the translations of many coordinates compute the projection themselves.
+         * In a subclass they only do so after it called this. Otherwise they call coordinateToDisplay() and
+         * displayToCoordinate(), so a subclass which reimplements these is still drawn right.
+         * @param inherited true if the subclass doesn't reimplement coordinateToDisplay() and displayToCoordinate()
+         */
+        void setProjectionInherited(bool inherited = true);
+
         virtual void zoom_in();
         virtual void zoom_out();
         virtual QString query(int x, int y, int z) const;
         virtual bool isTileValid(int x, int y, int z) const;
 
     private:
+        bool ownProjection() const;
         virtual QString getQ(qreal ux, qreal uy, qreal ox, qreal oy) const;
 
         qreal coord_per_x_tile;
@@ -71,6 +85,7 @@ namespace qmapcontrol
         
         QHash<QString,QString> mServerOptions;
         QHash<int,qreal>    mResolutions;
+        bool projectionInherited;
     };
 }
 #endif